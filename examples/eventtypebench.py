@@ -0,0 +1,99 @@
+#!/usr/bin/python
+#
+# eventtypebench.py
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., Franklin Street, Fifth Floor,
+# Boston MA  02110-1301 USA.
+#
+# Benchmark dispatching synthetic events through the Registry, getting the
+# event type of each one by parsing it on every access, by parsing it once per
+# event as pyatspi used to, or through EventType.intern.
+
+import sys
+import time
+
+import pyatspi
+from pyatspi.Accessibility import getEventType
+
+EVENTS = 1000000
+
+TYPES = [
+    "object:state-changed:focused",
+    "object:state-changed:showing",
+    "object:children-changed:add",
+    "object:children-changed:remove",
+    "object:property-change:accessible-name",
+    "object:property-change:accessible-description",
+    "object:bounds-changed",
+    "object:text-caret-moved",
+    "object:text-changed:insert",
+    "object:text-changed:delete",
+    "object:selection-changed",
+    "window:activate",
+    "window:deactivate",
+    "document:load-complete",
+]
+
+class UncachedEvent(object):
+    def __init__(self, rawType):
+        self.rawType = rawType
+
+    @property
+    def type(self):
+        return pyatspi.EventType(self.rawType)
+
+class PerEventEvent(object):
+    def __init__(self, rawType):
+        self.rawType = rawType
+
+    @property
+    def type(self):
+        try:
+            return self.pyType
+        except AttributeError:
+            self.pyType = pyatspi.EventType(self.rawType)
+            return self.pyType
+
+class InternedEvent(object):
+    type = property(fget=getEventType)
+
+    def __init__(self, rawType):
+        self.rawType = rawType
+
+def run(label, event_class):
+    registry = pyatspi.Registry
+    calls = [0]
+    def listener(event):
+        calls[0] += 1
+    registry.registerEventListener(listener, "object", "window", "document")
+    # the strings as libatspi would hand them over: a new object per event
+    raw = [t.encode() for t in TYPES]
+    events = [event_class(raw[i % len(raw)].decode()) for i in range(EVENTS)]
+    t0 = time.perf_counter()
+    for event in events:
+        registry._dispatchEvent(event)
+    elapsed = time.perf_counter() - t0
+    registry.deregisterEventListener(listener, "object", "window", "document")
+    print("%-10s %d events in %.2f s, %.0f ns/event" %
+          (label, calls[0], elapsed, elapsed / EVENTS * 1e9))
+
+def main():
+    run("uncached", UncachedEvent)
+    run("per-event", PerEventEvent)
+    run("interned", InternedEvent)
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
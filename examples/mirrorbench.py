@@ -0,0 +1,147 @@
+#!/usr/bin/python
+#
+# mirrorbench.py
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., Franklin Street, Fifth Floor,
+# Boston MA  02110-1301 USA.
+#
+# Benchmark keeping a TreeMirror of a synthetic tree up to date from events,
+# compared to walking the whole tree again after every change, and check the
+# mirror against a fresh walk at the end.
+
+import random
+import sys
+import time
+
+import pyatspi
+
+FANOUT = 8
+LEVELS = 4
+EVENTS = 20000
+
+class StateSet(object):
+    def __init__(self, states):
+        self.states = states
+
+class Node(object):
+    fetches = 0
+
+    def __init__(self, name):
+        self._name = name
+        self.states = 0
+        self.children = []
+
+    @property
+    def name(self):
+        Node.fetches += 1
+        return self._name
+
+    def getRole(self):
+        Node.fetches += 1
+        return pyatspi.ROLE_PANEL
+
+    def getState(self):
+        Node.fetches += 1
+        return StateSet(self.states)
+
+    def __len__(self):
+        return len(self.children)
+
+    def __getitem__(self, i):
+        Node.fetches += 1
+        return self.children[i]
+
+class Event(object):
+    def __init__(self, name, source, detail1=0, any_data=None):
+        self.type = pyatspi.EventType.intern(name)
+        self.source = source
+        self.detail1 = detail1
+        self.detail2 = 0
+        self.any_data = any_data
+
+def build(level=0, name="root"):
+    node = Node(name)
+    if level < LEVELS:
+        node.children = [build(level + 1, "%s.%d" % (name, i)) for i in range(FANOUT)]
+    return node
+
+def nodes(root):
+    stack = [root]
+    while stack:
+        node = stack.pop()
+        yield node
+        stack.extend(node.children)
+
+def events(root, rng):
+    """
+    Mutates the tree like an application would and yields the matching events.
+    """
+    serial = 0
+    showing = int(pyatspi.STATE_SHOWING)
+    while True:
+        population = list(nodes(root))
+        for i in range(100):
+            node = rng.choice(population)
+            kind = rng.random()
+            if kind < 0.5:
+                node.states ^= 1 << showing
+                yield Event("object:state-changed:showing", node, node.states >> showing & 1)
+            elif kind < 0.8:
+                node._name = "renamed-%d" % serial
+                serial += 1
+                yield Event("object:property-change:accessible-name", node, 0, node._name)
+            elif kind < 0.9 or not node.children:
+                child = Node("added-%d" % serial)
+                serial += 1
+                index = rng.randint(0, len(node.children))
+                node.children.insert(index, child)
+                yield Event("object:children-changed:add", node, index, child)
+            else:
+                index = rng.randrange(len(node.children))
+                child = node.children.pop(index)
+                yield Event("object:children-changed:remove", node, index, child)
+                break
+
+def main():
+    rng = random.Random(42)
+    root = build()
+    registry = pyatspi.Registry
+    Node.fetches = 0
+    t0 = time.perf_counter()
+    mirror = pyatspi.TreeMirror(root, registry=registry)
+    walk = time.perf_counter() - t0
+    walk_nodes, walk_calls = len(mirror), Node.fetches
+    print("initial walk: %d nodes, %d remote calls, %.1f ms" %
+          (len(mirror), Node.fetches, walk * 1e3))
+
+    Node.fetches = 0
+    stream = events(root, rng)
+    t0 = time.perf_counter()
+    for i in range(EVENTS):
+        registry._dispatchEvent(next(stream))
+    mirror.refresh()
+    elapsed = time.perf_counter() - t0
+    print("%d events: %.1f us/event, %.2f remote calls/event" %
+          (EVENTS, elapsed / EVENTS * 1e6, Node.fetches / float(EVENTS)))
+    print("re-walking instead: about %.0f us and %d remote calls per event" %
+          (walk * 1e6 * len(mirror) / walk_nodes, walk_calls * len(mirror) // walk_nodes))
+
+    differences = mirror.check()
+    mirror.close()
+    print("consistency check: %d differences" % len(differences))
+    return 1 if differences else 0
+
+if __name__ == "__main__":
+    sys.exit(main())
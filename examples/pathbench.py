@@ -0,0 +1,105 @@
+#!/usr/bin/python
+#
+# pathbench.py
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., Franklin Street, Fifth Floor,
+# Boston MA  02110-1301 USA.
+#
+# Benchmark getPath and findAncestor on the leaves of a 30 levels deep
+# synthetic tree, with and without the parent cache, counting the parent and
+# index lookups which would each be a D-Bus round-trip on a live application.
+
+import sys
+import time
+
+import pyatspi
+
+DEPTH = 30
+FANOUT = 3
+CALLS = 10000
+
+class Node(object):
+    fetches = 0
+
+    def __init__(self, name, parent=None):
+        self.name = name
+        self._parent = parent
+        self.children = []
+
+    @property
+    def parent(self):
+        Node.fetches += 1
+        return self._parent
+
+    def getIndexInParent(self):
+        Node.fetches += 1
+        return self._parent.children.index(self)
+
+class Event(object):
+    def __init__(self, name, source, detail1=0, any_data=None):
+        self.type = pyatspi.EventType.intern(name)
+        self.source = source
+        self.detail1 = detail1
+        self.detail2 = 0
+        self.any_data = any_data
+
+def build():
+    """
+    A spine of DEPTH nodes, each with FANOUT - 1 siblings before the next one.
+    """
+    root = node = Node("root")
+    for depth in range(DEPTH):
+        for i in range(FANOUT - 1):
+            node.children.append(Node("side-%d-%d" % (depth, i), node))
+        child = Node("spine-%d" % depth, node)
+        node.children.append(child)
+        node = child
+    return root, node
+
+def run(label, leaf):
+    Node.fetches = 0
+    t0 = time.perf_counter()
+    for i in range(CALLS):
+        path = pyatspi.getPath(leaf)
+        pyatspi.findAncestor(leaf, lambda x: x.name == "root")
+    elapsed = time.perf_counter() - t0
+    print("%-22s %6.1f us/call %8.2f lookups/call" %
+          (label, elapsed / CALLS * 1e6, Node.fetches / float(CALLS)))
+    return path
+
+def main():
+    root, leaf = build()
+    registry = pyatspi.Registry
+    expected = run("uncached", leaf)
+    pyatspi.setParentCacheEnabled(True)
+    cached = run("cached", leaf)
+
+    # insert a node in the middle of the spine, as an application would
+    parent = leaf
+    for i in range(DEPTH // 2):
+        parent = parent._parent
+    parent.children.insert(0, Node("inserted", parent))
+    registry._dispatchEvent(Event("object:children-changed:add", parent, 0,
+                                  parent.children[0]))
+    after = run("cached, after insert", leaf)
+    pyatspi.setParentCacheEnabled(False)
+    fresh = pyatspi.getPath(leaf)
+
+    ok = cached == expected and after == fresh and after != expected
+    print("paths consistent: %s" % ok)
+    return 0 if ok else 1
+
+if __name__ == "__main__":
+    sys.exit(main())
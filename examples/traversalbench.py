@@ -0,0 +1,89 @@
+#!/usr/bin/python
+#
+# traversalbench.py
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., Franklin Street, Fifth Floor,
+# Boston MA  02110-1301 USA.
+#
+# Benchmark findDescendant and findAllDescendants on a deep synthetic tree,
+# counting the child accesses which would each be a D-Bus round-trip on a
+# live application.
+
+import sys
+import time
+
+import pyatspi
+
+DEPTH = 3000
+FANOUT = 4
+
+class Node(object):
+    accesses = 0
+
+    def __init__(self, name, parent=None):
+        self.name = name
+        self.parent = parent
+        self.children = []
+
+    def __len__(self):
+        return len(self.children)
+
+    def __getitem__(self, i):
+        Node.accesses += 1
+        return self.children[i]
+
+def build():
+    """
+    A spine of DEPTH nodes, each with FANOUT - 1 leaves next to the next spine
+    node, which is the last child.
+    """
+    root = node = Node("root")
+    for depth in range(DEPTH):
+        for i in range(FANOUT - 1):
+            node.children.append(Node("leaf-%d-%d" % (depth, i), node))
+        child = Node("spine-%d" % depth, node)
+        node.children.append(child)
+        node = child
+    return root
+
+def run(label, func):
+    Node.accesses = 0
+    t0 = time.perf_counter()
+    result = func()
+    elapsed = time.perf_counter() - t0
+    print("%-28s %8.1f ms %8d child accesses  -> %s" %
+          (label, elapsed * 1e3, Node.accesses, result))
+
+def main():
+    root = build()
+    deepest = "spine-%d" % (DEPTH - 1)
+    by_name = lambda name: lambda x: x.name == name
+    run("find deepest (depth first)",
+        lambda: pyatspi.findDescendant(root, by_name(deepest)).name)
+    run("find deepest (breadth first)",
+        lambda: pyatspi.findDescendant(root, by_name(deepest), True).name)
+    run("find, max_depth=10",
+        lambda: pyatspi.findDescendant(root, by_name(deepest), max_depth=10))
+    run("find, pruning at spine-100",
+        lambda: pyatspi.findDescendant(root, by_name(deepest),
+                                       prune=lambda x: x.name == "spine-100"))
+    run("find, max_nodes=1000",
+        lambda: pyatspi.findDescendant(root, by_name(deepest), max_nodes=1000))
+    run("find all leaves",
+        lambda: len(pyatspi.findAllDescendants(root, lambda x: not x.children)))
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
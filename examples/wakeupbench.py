@@ -0,0 +1,72 @@
+#!/usr/bin/python
+#
+# wakeupbench.py
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., Franklin Street, Fifth Floor,
+# Boston MA  02110-1301 USA.
+#
+# Micro-benchmark comparing the legacy GIL releasing idle callback of
+# Registry.start(gil=True) with Registry.start(wakeup=True). A worker thread
+# hands calls to the main loop through Registry.callFromThread and measures
+# how long they take to run, then sleeps to measure idle CPU use.
+
+import sys
+import threading
+import time
+
+import pyatspi
+
+SAMPLES = 200
+IDLE_SECONDS = 1.0
+
+def worker(registry, latencies, cpu):
+    # let the main loop settle
+    time.sleep(0.1)
+    done = threading.Event()
+    def handoff(t0):
+        latencies.append(time.perf_counter() - t0)
+        done.set()
+    for i in range(SAMPLES):
+        done.clear()
+        registry.callFromThread(handoff, time.perf_counter())
+        done.wait()
+    t0 = time.process_time()
+    time.sleep(IDLE_SECONDS)
+    cpu.append((time.process_time() - t0) / IDLE_SECONDS)
+    registry.callFromThread(registry.stop)
+
+def run(label, **kwargs):
+    registry = pyatspi.Registry
+    latencies = []
+    cpu = []
+    thread = threading.Thread(target=worker, args=(registry, latencies, cpu))
+    thread.start()
+    registry.start(**kwargs)
+    thread.join()
+    latencies.sort()
+    print("%-8s median %8.1f us   p99 %8.1f us   max %8.1f us   idle cpu %5.1f%%" %
+          (label,
+           latencies[len(latencies) // 2] * 1e6,
+           latencies[int(len(latencies) * 0.99)] * 1e6,
+           latencies[-1] * 1e6,
+           cpu[0] * 100))
+
+def main():
+    run("gil", gil=True)
+    run("wakeup", wakeup=True)
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
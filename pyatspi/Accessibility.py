@@ -17,6 +17,8 @@ from gi.repository import Atspi
 from pyatspi.registry import *
 Registry = Registry()
 
+from pyatspi.cachestats import registerCache
+
 from pyatspi.application import *
 from pyatspi.constants import *
 from pyatspi.editabletext import *
@@ -25,6 +27,7 @@ from pyatspi.state import *
 from pyatspi.text import *
 from pyatspi.document import *
 from pyatspi.utils import *
+from pyatspi.utils import _busName, _role
 from pyatspi.action import *
 from pyatspi.component import *
 from pyatspi.collection import *
@@ -35,6 +38,16 @@ from pyatspi.table import *
 from pyatspi.tablecell import *
 from pyatspi.value import *
 from pyatspi.appevent import *
+from pyatspi.cachebudget import *
+from pyatspi.eventfilter import *
+from pyatspi.eventlog import *
+from pyatspi.eventloop import *
+from pyatspi.eventqueue import *
+from pyatspi.eventstats import *
+from pyatspi.mirror import *
+from pyatspi.parentcache import *
+from pyatspi.pipeline import *
+from pyatspi.snapshot import *
 from pyatspi.interface import *
 
 def Accessible_getitem(self, i):
@@ -45,6 +58,31 @@ def Accessible_getitem(self, i):
                 raise IndexError
         return self.get_child_at_index(i)
 
+# match rule without criteria, giving every child
+_every_child = Match()
+
+def Accessible_getChildren(self):
+        '''
+        Gets all the children of the accessible. When the application
+        implements Collection, they come from a single getMatches call limited
+        to the children; otherwise the child count is queried once, and then
+        each child by index.
+
+        @return: Children of the accessible
+        @rtype: list of Accessibility.Accessible
+        '''
+        try:
+                collection = self.queryCollection()
+                return list(collection.getMatches(_every_child._matchRule(collection),
+                                                  Collection.SORT_ORDER_CANONICAL, 0, False))
+        except Exception:
+                pass
+        get_child_at_index = self.get_child_at_index
+        return [get_child_at_index(i) for i in range(self.get_child_count())]
+
+def Accessible_iter(self):
+        return iter(self.getChildren())
+
 def Accessible_str(self):
         '''
         Gets a human readable representation of the accessible.
@@ -68,11 +106,70 @@ def getInterface(func, obj):
         raise NotImplementedError
 
 def getEventType(event):
+        event_type = getattr(event, 'pyType', None)
+        if event_type is None:
+                event_type = event.pyType = EventType.intern(event.rawType)
+        return event_type
+
+# application bus name -> application accessible, see Event_host_application.
+# Unique bus names are never reused, so entries only go stale by piling up.
+_applications = {}
+_APPLICATIONS_MAX = 256
+
+def _clearApplications():
+        count = len(_applications)
+        _applications.clear()
+        return count
+
+_applications_counter = registerCache('applications', _clearApplications,
+                                      lambda: len(_applications))
+
+def Event_source_name(self):
+        '''
+        Gets the name of the event source, fetched once per event.
+        '''
+        try:
+                return self._source_name
+        except AttributeError:
+                pass
+        name = self._source_name = self.source.name
+        return name
+
+def Event_source_role(self):
+        '''
+        Gets the role of the event source, fetched once per event. The role held
+        in the libatspi cache is used when there is one.
+        '''
+        try:
+                return self._source_role
+        except AttributeError:
+                pass
+        role = self._source_role = _role(self.source)
+        return role
+
+def Event_host_application(self):
+        '''
+        Gets the application the event source belongs to. Applications are
+        cached by bus name, so only the first event from an application costs a
+        lookup.
+        '''
         try:
-                return event.pyType
-        except:
-                event.pyType = EventType(event.rawType)
-                return event.pyType
+                return self._host_application
+        except AttributeError:
+                pass
+        bus_name = _busName(self.source)
+        app = _applications.get(bus_name)
+        if app is not None:
+                _applications_counter.hit()
+        else:
+                _applications_counter.miss()
+                app = self.source.get_application()
+                if bus_name is not None and app is not None:
+                        if len(_applications) >= _APPLICATIONS_MAX:
+                                _applications_counter.clear()
+                        _applications[bus_name] = app
+        self._host_application = app
+        return app
 
 def DeviceEvent_str(self):
         '''
@@ -113,12 +210,14 @@ Atspi.Accessible.getChildAtIndex = Atspi.Accessible.get_child_at_index
 Atspi.Accessible.getAttributes = Atspi.Accessible.get_attributes_as_array
 Atspi.Accessible.getApplication = Atspi.Accessible.get_application
 Atspi.Accessible.__getitem__ = Accessible_getitem
+Atspi.Accessible.__iter__ = Accessible_iter
 Atspi.Accessible.__len__ = Atspi.Accessible.get_child_count
 Atspi.Accessible.__bool__ = lambda x: True
 Atspi.Accessible.__nonzero__ = lambda x: True
 Atspi.Accessible.__str__ = Accessible_str
 Atspi.Accessible.childCount = property(fget=Atspi.Accessible.get_child_count)
 Atspi.Accessible.getChildCount = Atspi.Accessible.get_child_count
+Atspi.Accessible.getChildren = Accessible_getChildren
 Atspi.Accessible.getIndexInParent = Atspi.Accessible.get_index_in_parent
 Atspi.Accessible.getLocalizedRoleName = Atspi.Accessible.get_localized_role_name
 Atspi.Accessible.getRelationSet = Atspi.Accessible.get_relation_set
@@ -182,10 +281,10 @@ Atspi.Hyperlink.startIndex = property(fget=Atspi.Hyperlink.get_start_index)
 Atspi.DeviceEvent.__str__ = DeviceEvent_str
 
 ### event ###
-Atspi.Event.host_application = property(fget=lambda x: x.source.get_application())
+Atspi.Event.host_application = property(fget=Event_host_application)
 Atspi.Event.rawType = Atspi.Event.type
-Atspi.Event.source_name = property(fget=lambda x: x.source.name)
-Atspi.Event.source_role = property(fget=lambda x: x.source.getRole())
+Atspi.Event.source_name = property(fget=Event_source_name)
+Atspi.Event.source_role = property(fget=Event_source_role)
 Atspi.Event.type = property(fget=getEventType)
 Atspi.Event.__str__ = Event_str
 
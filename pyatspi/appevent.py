@@ -27,6 +27,10 @@ class EventType(str):
         individually as klass (can't use the keyword class), major, minor, and detail 
         (klass_major_minor_detail).
 
+        Use L{intern} to get an already parsed instance for an event type string
+        received from AT-SPI. Interned instances are shared by every event of
+        that type, so they should not be modified.
+
         @note: All attributes of an instance of this class should be considered 
                 public readable as it is acting a a struct.
         @ivar klass: Most general event type identifier (object, window, mouse, etc.)
@@ -45,6 +49,10 @@ class EventType(str):
 
         _SEPARATOR = ':'
 
+        # raw type string -> EventType, see intern()
+        _interned = {}
+        _INTERN_MAX = 1024
+
         def __init__(self, name):
                 """
                 Parses the full AT-SPI event name into its components
@@ -64,6 +72,27 @@ class EventType(str):
                 self.minor = self._separated[2]
                 self.detail = self._separated[3]
 
+        @classmethod
+        def intern(cls, name):
+                """
+                Gets the shared instance for an event type string, parsing it only the
+                first time it is seen. The table is bounded: it is emptied when it
+                reaches _INTERN_MAX entries, so a flood of distinct names cannot grow
+                it without limit.
+
+                @param name: Full AT-SPI event name
+                @type name: string
+                @rtype: L{EventType}
+                """
+                try:
+                        return cls._interned[name]
+                except KeyError:
+                        pass
+                if len(cls._interned) >= cls._INTERN_MAX:
+                        cls._interned.clear()
+                event_type = cls._interned[name] = cls(name)
+                return event_type
+
         def is_subtype(self, event_type, excludeSelf = False):
                 """
                 Determines if the passed event type is a subtype
@@ -0,0 +1,150 @@
+#This library is free software; you can redistribute it and/or
+#modify it under the terms of the GNU Lesser General Public
+#License version 2 as published by the Free Software Foundation.
+
+#This program is distributed in the hope that it will be useful,
+#but WITHOUT ANY WARRANTY; without even the implied warranty of
+#MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#GNU General Public License for more details.
+#You should have received a copy of the GNU Lesser General Public License
+#along with this program; if not, write to the Free Software
+#Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+import collections
+import threading
+
+from pyatspi.cachestats import registerCache
+from pyatspi.utils import _busName
+
+__all__ = [
+           "CacheBudget",
+          ]
+
+#------------------------------------------------------------------------------
+
+class CacheBudget(object):
+        """
+        Bounds the number of accessibles whose data libatspi treats as cached,
+        per application. Accessibles are tracked in least recently used order
+        as they are touched, by the L{Registry} for every event source; when an
+        application goes over budget, the least recently used ones have their
+        libatspi cache cleared, so that their data is fetched again when it is
+        next needed, and are forgotten.
+
+        This bounds how much cached data can go stale and the memory held by
+        the budget itself, not the number of objects: libatspi keeps every
+        accessible it has handed out until the application removes it, and
+        clearing the cache only marks the data as invalid. The budget holds a
+        reference to each tracked accessible, at most max_objects per
+        application besides the pinned ones, so that it can clear the evicted
+        ones. The L{Registry}
+        forgets the applications which leave the desktop.
+
+        The focused object and its ancestors are pinned: they are never evicted,
+        since they are what an assistive technology reads next. Only the
+        ancestors libatspi already knows are pinned, so that pinning makes no
+        remote call while events are received.
+
+        Counters are reported under 'accessibles' by L{printCache}: a hit is an
+        accessible touched again while tracked, a miss a new one.
+        """
+
+        # ancestors pinned above the focused object
+        MAX_PINNED_DEPTH = 100
+
+        def __init__(self, max_objects):
+                """
+                @param max_objects: Maximum number of tracked accessibles per
+                        application
+                @type max_objects: integer
+                @raise ValueError: When max_objects is not positive
+                """
+                if max_objects < 1:
+                        raise ValueError("max_objects must be positive")
+                self.max_objects = max_objects
+                # bus name -> path -> accessible, least recently used first
+                self._apps = {}
+                # (bus name, path) of the pinned accessibles
+                self._pinned = frozenset()
+                self._lock = threading.Lock()
+                self.counter = registerCache('accessibles', self.clear, self.__len__)
+
+        def __len__(self):
+                with self._lock:
+                        return sum(len(lru) for lru in self._apps.values())
+
+        def touch(self, acc):
+                """
+                Marks an accessible as used, evicting others if its application goes
+                over budget.
+                """
+                bus_name = _busName(acc)
+                path = getattr(acc, 'path', None)
+                if bus_name is None or path is None:
+                        return
+                with self._lock:
+                        lru = self._apps.get(bus_name)
+                        if lru is None:
+                                lru = self._apps[bus_name] = collections.OrderedDict()
+                        if path in lru:
+                                lru.move_to_end(path)
+                                self.counter.hit()
+                                return
+                        lru[path] = acc
+                        self.counter.miss()
+                        if len(lru) <= self.max_objects:
+                                return
+                        victims = []
+                        for old in list(lru):
+                                if len(lru) <= self.max_objects:
+                                        break
+                                if old == path or (bus_name, old) in self._pinned:
+                                        continue
+                                victims.append(lru.pop(old))
+                self.counter.evict(len(victims))
+                # outside of the lock: these are calls into libatspi
+                for victim in victims:
+                        try:
+                                victim.clearCache()
+                        except Exception:
+                                pass
+
+        def focus(self, acc):
+                """
+                Pins the newly focused accessible and the ancestors libatspi knows,
+                releasing the previously pinned ones.
+                """
+                nodes = []
+                pinned = set()
+                node = acc
+                while node is not None and len(nodes) < self.MAX_PINNED_DEPTH:
+                        key = (_busName(node), getattr(node, 'path', None))
+                        if key in pinned:
+                                break
+                        pinned.add(key)
+                        nodes.append(node)
+                        # the cached parent: get_parent would be a round-trip
+                        # for objects libatspi has not cached the parent of
+                        node = getattr(node, 'accessible_parent', None)
+                self._pinned = frozenset(pinned)
+                for node in nodes:
+                        self.touch(node)
+
+        def forget(self, bus_name):
+                """
+                Drops the accessibles of an application, for instance once it exited.
+                """
+                with self._lock:
+                        self._apps.pop(bus_name, None)
+
+        def clear(self):
+                """
+                Forgets every tracked accessible. Their libatspi cache is left alone.
+
+                @return: Number of accessibles forgotten
+                @rtype: integer
+                """
+                with self._lock:
+                        count = sum(len(lru) for lru in self._apps.values())
+                        self._apps.clear()
+                        return count
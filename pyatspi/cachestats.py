@@ -0,0 +1,111 @@
+#This library is free software; you can redistribute it and/or
+#modify it under the terms of the GNU Lesser General Public
+#License version 2 as published by the Free Software Foundation.
+
+#This program is distributed in the hope that it will be useful,
+#but WITHOUT ANY WARRANTY; without even the implied warranty of
+#MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#GNU General Public License for more details.
+#You should have received a copy of the GNU Lesser General Public License
+#along with this program; if not, write to the Free Software
+#Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+import threading
+
+__all__ = [
+           "CacheCounter",
+           "registerCache",
+           "getCacheStats",
+          ]
+
+#------------------------------------------------------------------------------
+
+class CacheCounter(object):
+        """
+        Hit, miss and eviction counters of one of the caches kept by pyatspi,
+        reported by L{printCache} and emptied by L{clearCache}.
+
+        @ivar name: Name of the cache
+        @type name: string
+        """
+
+        def __init__(self, name, clear=None, size=None):
+                """
+                @param clear: Callable emptying the cache and returning the number of
+                        entries dropped
+                @type clear: callable
+                @param size: Callable returning the number of entries in the cache
+                @type size: callable
+                """
+                self.name = name
+                self._clear = clear
+                self._size = size
+                self.reset()
+
+        def reset(self):
+                self.hits = 0
+                self.misses = 0
+                self.evictions = 0
+
+        def hit(self):
+                self.hits += 1
+
+        def miss(self):
+                self.misses += 1
+
+        def evict(self, count=1):
+                self.evictions += count
+
+        def clear(self):
+                if self._clear is not None:
+                        self.evict(self._clear() or 0)
+
+        def size(self):
+                if self._size is None:
+                        return None
+                return self._size()
+
+        def toDict(self):
+                lookups = self.hits + self.misses
+                return {
+                        "size": self.size(),
+                        "hits": self.hits,
+                        "misses": self.misses,
+                        "hit_ratio": float(self.hits) / lookups if lookups else None,
+                        "evictions": self.evictions,
+                }
+
+_caches = {}
+_lock = threading.Lock()
+
+def registerCache(name, clear=None, size=None):
+        """
+        Gets the counters of a cache, creating them on first use. Giving new
+        callables to an existing cache replaces the old ones.
+
+        @param name: Name of the cache
+        @type name: string
+        @param clear: See L{CacheCounter}
+        @param size: See L{CacheCounter}
+        @rtype: L{CacheCounter}
+        """
+        with _lock:
+                counter = _caches.get(name)
+                if counter is None:
+                        counter = _caches[name] = CacheCounter(name, clear, size)
+                elif clear is not None or size is not None:
+                        # the cache was replaced, keep its counters
+                        counter._clear = clear
+                        counter._size = size
+                return counter
+
+def caches():
+        with _lock:
+                return list(_caches.values())
+
+def getCacheStats():
+        """
+        @return: Counters of every cache, by cache name
+        @rtype: dictionary
+        """
+        return dict((counter.name, counter.toDict()) for counter in caches())
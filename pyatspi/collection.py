@@ -13,12 +13,16 @@
 #along with this program; if not, write to the Free Software
 #Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 
+import re
+
 from gi.repository import Atspi
+from gi.repository import GLib
 from pyatspi.atspienum import *
 from pyatspi.utils import *
 
 __all__ = [
            "Collection",
+           "Match",
            "SortOrder",
            "MatchType",
            "TreeTraversalType",
@@ -103,3 +107,142 @@ class Collection:
 
         def getActiveDescendant(self):
                 return Atspi.Collection.get_active_descendant(self.obj)
+
+#------------------------------------------------------------------------------
+
+def _bitfield(values, words):
+        """
+        Packs enumeration values as bits in an array of signed 32 bit words.
+        """
+        bits = [0] * words
+        for value in values:
+                bits[int(value) // 32] |= 1 << (int(value) % 32)
+        return [word - (1 << 32) if word >= 1 << 31 else word for word in bits]
+
+class Match:
+        """
+        Declarative search predicate for L{findDescendant} and
+        L{findAllDescendants}. For example,
+
+        match = pyatspi.Match(roles=[pyatspi.ROLE_PUSH_BUTTON],
+                              states=[pyatspi.STATE_SHOWING])
+        buttons = pyatspi.findAllDescendants(frame, match)
+
+        When the application implements the Collection interface, the roles,
+        states, attributes and interfaces are compiled to a match rule and the
+        whole search is a single getMatches call; only the name pattern, if any,
+        is then checked on the results. Otherwise, or when the search is limited
+        in ways Collection cannot express, the predicate is evaluated on each
+        node like any other.
+
+        A Match is also a plain callable predicate taking an accessible.
+        """
+
+        def __init__(self, roles=None, states=None, attributes=None, interfaces=None,
+                     name=None):
+                """
+                @param roles: Roles of which the accessible must have one
+                @type roles: list of Accessibility.Role
+                @param states: States the accessible must all have
+                @type states: list of Accessibility.StateType
+                @param attributes: Object attributes the accessible must all have
+                @type attributes: dictionary
+                @param interfaces: Names of interfaces, like 'Action' or 'Text', the
+                        accessible must all implement
+                @type interfaces: list of string
+                @param name: Regular expression searched in the name of the accessible
+                @type name: string
+                """
+                self.roles = list(roles or ())
+                self.states = list(states or ())
+                self.attributes = dict(attributes or {})
+                self.interfaces = list(interfaces or ())
+                self.name = re.compile(name) if name is not None else None
+                self._rule = None
+
+        def __call__(self, acc):
+                if self.roles and acc.getRole() not in self.roles:
+                        return False
+                if self.states:
+                        state_set = acc.getState()
+                        for state in self.states:
+                                if not state_set.contains(state):
+                                        return False
+                if self.attributes:
+                        attributes = attributeListToHash(acc.getAttributes())
+                        for key, value in self.attributes.items():
+                                if attributes.get(key) != value:
+                                        return False
+                if self.interfaces:
+                        implemented = acc.get_interfaces()
+                        for interface in self.interfaces:
+                                if interface not in implemented:
+                                        return False
+                if self.name is not None and not self.name.search(acc.name or ''):
+                        return False
+                return True
+
+        def _matchType(self, criteria, match_type):
+                # an empty criterion must not constrain the match
+                if criteria:
+                        return match_type
+                return Collection.MATCH_NONE
+
+        def _matchRule(self, collection):
+                if self._rule is None:
+                        states = Atspi.StateSet(*self.states)
+                        self._rule = collection.createMatchRule(
+                                states, self._matchType(self.states, Collection.MATCH_ALL),
+                                hashToAttributeList(self.attributes),
+                                self._matchType(self.attributes, Collection.MATCH_ALL),
+                                self.roles, self._matchType(self.roles, Collection.MATCH_ANY),
+                                self.interfaces,
+                                self._matchType(self.interfaces, Collection.MATCH_ALL),
+                                False)
+                return self._rule
+
+        def _ruleVariant(self):
+                """
+                @return: The match rule in the form Collection.GetMatches takes on
+                        the bus, for searches which do not go through libatspi
+                @rtype: GLib.Variant
+                """
+                return GLib.Variant('(aiia{ss}iaiiasib)', (
+                        _bitfield(self.states, 2),
+                        int(self._matchType(self.states, Collection.MATCH_ALL)),
+                        self.attributes,
+                        int(self._matchType(self.attributes, Collection.MATCH_ALL)),
+                        _bitfield(self.roles, 4),
+                        int(self._matchType(self.roles, Collection.MATCH_ANY)),
+                        self.interfaces,
+                        int(self._matchType(self.interfaces, Collection.MATCH_ALL)),
+                        False))
+
+        def findAll(self, acc, count=0):
+                """
+                Searches the descendants of acc through the Collection interface.
+
+                @param acc: Root accessible of the search
+                @type acc: Accessibility.Accessible
+                @param count: Maximum number of matches, 0 for no limit
+                @type count: integer
+                @return: Matching accessibles in depth-first order, or None when acc
+                        does not support Collection and the search must be done node
+                        by node
+                @rtype: list or None
+                """
+                try:
+                        collection = acc.queryCollection()
+                        # with a name pattern, the limit applies after filtering
+                        matches = collection.getMatches(self._matchRule(collection),
+                                                        Collection.SORT_ORDER_CANONICAL,
+                                                        0 if self.name else count, True)
+                except Exception:
+                        return None
+                matches = list(matches)
+                if self.name is not None:
+                        matches = [match for match in matches
+                                   if self.name.search(match.name or '')]
+                        if count:
+                                matches = matches[:count]
+                return matches
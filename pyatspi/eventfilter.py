@@ -0,0 +1,89 @@
+#This library is free software; you can redistribute it and/or
+#modify it under the terms of the GNU Lesser General Public
+#License version 2 as published by the Free Software Foundation.
+
+#This program is distributed in the hope that it will be useful,
+#but WITHOUT ANY WARRANTY; without even the implied warranty of
+#MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#GNU General Public License for more details.
+#You should have received a copy of the GNU Lesser General Public License
+#along with this program; if not, write to the Free Software
+#Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+from pyatspi.utils import _busName, _role
+
+__all__ = [
+           "EventFilter",
+          ]
+
+#------------------------------------------------------------------------------
+
+def _valueSet(values):
+        if values is None:
+                return None
+        if isinstance(values, int):
+                return frozenset((values,))
+        return frozenset(values)
+
+class EventFilter(object):
+        """
+        Declarative conditions on the events delivered to a client, given to
+        L{Registry.registerEventListener}. Events failing them are discarded
+        before the client is called. Conditions are checked from the cheapest to
+        the most expensive: detail values, then the bus name of the source
+        application, which are both carried by the event, then the role of the
+        source, which libatspi usually has in its cache.
+
+        Each condition is a value or a collection of accepted values; None
+        accepts anything.
+        """
+
+        def __init__(self, applications=None, roles=None, detail1=None, detail2=None):
+                """
+                @param applications: D-Bus names of the applications whose events are
+                        accepted
+                @type applications: string or collection of strings
+                @param roles: Accepted roles of the event source, e.g.
+                        (ROLE_PUSH_BUTTON, ROLE_TOGGLE_BUTTON)
+                @type roles: Accessibility.Role or collection of them
+                @param detail1: Accepted values of detail1
+                @type detail1: integer or collection of integers
+                @param detail2: Accepted values of detail2
+                @type detail2: integer or collection of integers
+                """
+                if isinstance(applications, str):
+                        applications = (applications,)
+                self.applications = _valueSet(applications)
+                self.roles = None
+                if roles is not None:
+                        self.roles = frozenset(int(role) for role in _valueSet(roles))
+                self.detail1 = _valueSet(detail1)
+                self.detail2 = _valueSet(detail2)
+
+        def __bool__(self):
+                return not (self.applications is None and self.roles is None and
+                            self.detail1 is None and self.detail2 is None)
+
+        def match(self, event):
+                """
+                @param event: Received event
+                @type event: Atspi.Event
+                @return: Does the event meet every condition?
+                @rtype: boolean
+                """
+                if self.detail1 is not None and event.detail1 not in self.detail1:
+                        return False
+                if self.detail2 is not None and event.detail2 not in self.detail2:
+                        return False
+                if self.applications is not None and \
+                   _busName(event.source) not in self.applications:
+                        return False
+                if self.roles is not None:
+                        try:
+                                role = _role(event.source)
+                        except Exception:
+                                # the source went away
+                                return False
+                        if int(role) not in self.roles:
+                                return False
+                return True
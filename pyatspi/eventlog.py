@@ -0,0 +1,283 @@
+#This library is free software; you can redistribute it and/or
+#modify it under the terms of the GNU Lesser General Public
+#License version 2 as published by the Free Software Foundation.
+
+#This program is distributed in the hope that it will be useful,
+#but WITHOUT ANY WARRANTY; without even the implied warranty of
+#MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#GNU General Public License for more details.
+#You should have received a copy of the GNU Lesser General Public License
+#along with this program; if not, write to the Free Software
+#Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+import struct
+import threading
+import time
+
+from pyatspi.appevent import EventType
+from pyatspi.utils import _busName
+
+__all__ = [
+           "EventRecorder",
+           "EventReplayer",
+           "RecordedEvent",
+           "RecordedSource",
+          ]
+
+#------------------------------------------------------------------------------
+
+# The log starts with _MAGIC and is followed by records, each introduced by a
+# one byte kind:
+#   _STRING: u16 length, UTF-8 bytes. Defines the next string id.
+#   _EVENT:  f64 timestamp, i32 detail1, i32 detail2 and u32 string ids of the
+#            type, any_data summary, source bus name and source path.
+#   _SESSION: no data. Starts a recording appended to an existing log; string
+#            ids start again from 0.
+# Strings are written once and referred to by id afterwards, which keeps the
+# usual stream of repeated event types and object paths compact.
+
+_MAGIC = b'PYATSPI-EVLOG\x01'
+_STRING = 0
+_EVENT = 1
+_SESSION = 2
+
+_KIND = struct.Struct('<B')
+_LENGTH = struct.Struct('<H')
+_RECORD = struct.Struct('<dii4I')
+
+_MAX_STRING = 0xffff
+
+def _summarize(value):
+        """
+        Reduces an any_data value to a short string: plain values are kept, other
+        objects are described by their type.
+        """
+        if value is None:
+                return ''
+        if isinstance(value, (str, int, float, bool)):
+                return str(value)
+        return '<%s>' % type(value).__name__
+
+def _sourceAddress(source):
+        return (_busName(source) or '', getattr(source, 'path', None) or '')
+
+#------------------------------------------------------------------------------
+
+class EventRecorder(object):
+        """
+        Appends the events received by the L{Registry} to a binary log, see
+        L{Registry.startRecording}.
+        """
+
+        def __init__(self, fp):
+                """
+                @param fp: File name, or binary file object open for writing. A file
+                        object positioned after an existing log, e.g. open in append
+                        mode, gets a new session appended to it.
+                @type fp: string or file
+                """
+                if isinstance(fp, str):
+                        self._file = open(fp, 'wb')
+                        self._owned = True
+                else:
+                        self._file = fp
+                        self._owned = False
+                self._strings = {}
+                self._lock = threading.Lock()
+                self.count = 0
+                if self._file.tell() == 0:
+                        self._file.write(_MAGIC)
+                else:
+                        self._file.write(_KIND.pack(_SESSION))
+
+        def _string(self, value):
+                # called with the lock held
+                try:
+                        return self._strings[value]
+                except KeyError:
+                        pass
+                data = value.encode('utf-8')
+                if len(data) > _MAX_STRING:
+                        # cut on a character boundary
+                        data = data[:_MAX_STRING].decode('utf-8', 'ignore').encode('utf-8')
+                self._file.write(_KIND.pack(_STRING) + _LENGTH.pack(len(data)) + data)
+                index = self._strings[value] = len(self._strings)
+                return index
+
+        def record(self, event, timestamp=None):
+                """
+                Appends an event to the log.
+
+                @param event: Received event
+                @type event: Atspi.Event
+                @param timestamp: Reception time, defaults to now
+                @type timestamp: float
+                """
+                if timestamp is None:
+                        timestamp = time.time()
+                bus_name, path = _sourceAddress(event.source)
+                with self._lock:
+                        self._file.write(_KIND.pack(_EVENT) + _RECORD.pack(
+                                timestamp,
+                                event.detail1, event.detail2,
+                                self._string(str(event.type)),
+                                self._string(_summarize(event.any_data)),
+                                self._string(bus_name),
+                                self._string(path)))
+                        self.count += 1
+
+        def close(self):
+                with self._lock:
+                        self._file.flush()
+                        if self._owned:
+                                self._file.close()
+
+#------------------------------------------------------------------------------
+
+class RecordedSource(object):
+        """
+        Stands for the source of a replayed event. Only its address is known.
+
+        @ivar bus_name: D-Bus name of the application that sent the event
+        @type bus_name: string
+        @ivar path: D-Bus object path of the source
+        @type path: string
+        """
+
+        def __init__(self, bus_name, path):
+                self.bus_name = bus_name
+                self.path = path
+
+        def __eq__(self, other):
+                return (isinstance(other, RecordedSource) and
+                        self.bus_name == other.bus_name and self.path == other.path)
+
+        def __ne__(self, other):
+                return not self.__eq__(other)
+
+        def __hash__(self):
+                return hash((self.bus_name, self.path))
+
+        def __str__(self):
+                return '[%s %s]' % (self.bus_name, self.path)
+
+class RecordedEvent(object):
+        """
+        Event read back from a log by L{EventReplayer}. Provides the same data
+        attributes as Atspi.Event, with any_data reduced to its recorded summary.
+        """
+
+        def __init__(self, timestamp, rawType, detail1, detail2, any_data, source):
+                self.timestamp = timestamp
+                self.rawType = rawType
+                self.type = EventType.intern(rawType)
+                self.detail1 = detail1
+                self.detail2 = detail2
+                self.any_data = any_data
+                self.source = source
+                self.sender = None
+
+        def __str__(self):
+                return '%s(%s, %s, %s)\n\tsource: %s' % \
+                       (self.type, self.detail1, self.detail2, self.any_data, self.source)
+
+class EventReplayer(object):
+        """
+        Reads a log written by L{EventRecorder} and feeds it back to the
+        listeners registered on a L{Registry}.
+        """
+
+        def __init__(self, fp):
+                """
+                @param fp: File name, or binary file object open for reading
+                @type fp: string or file
+                """
+                self._fp = fp
+
+        def __iter__(self):
+                """
+                Iterates over the logged events as L{RecordedEvent} objects. A log
+                cut short, for instance by a crash while recording, ends with its
+                last complete event.
+
+                @raise ValueError: When the file is not an event log
+                """
+                if isinstance(self._fp, str):
+                        with open(self._fp, 'rb') as f:
+                                for event in self._read(f):
+                                        yield event
+                else:
+                        for event in self._read(self._fp):
+                                yield event
+
+        def _read(self, f):
+                if f.read(len(_MAGIC)) != _MAGIC:
+                        raise ValueError("not a pyatspi event log")
+                strings = []
+                sources = {}
+                while True:
+                        kind = f.read(_KIND.size)
+                        if not kind:
+                                return
+                        kind, = _KIND.unpack(kind)
+                        if kind == _STRING:
+                                length = f.read(_LENGTH.size)
+                                if len(length) < _LENGTH.size:
+                                        # truncated by a crash while recording
+                                        return
+                                length, = _LENGTH.unpack(length)
+                                data = f.read(length)
+                                if len(data) < length:
+                                        return
+                                strings.append(data.decode('utf-8'))
+                        elif kind == _SESSION:
+                                strings = []
+                                sources = {}
+                        elif kind == _EVENT:
+                                data = f.read(_RECORD.size)
+                                if len(data) < _RECORD.size:
+                                        # truncated by a crash while recording
+                                        return
+                                (timestamp, detail1, detail2,
+                                 type_id, any_data_id, bus_name_id, path_id) = _RECORD.unpack(data)
+                                key = (bus_name_id, path_id)
+                                source = sources.get(key)
+                                if source is None:
+                                        source = sources[key] = RecordedSource(strings[bus_name_id],
+                                                                               strings[path_id])
+                                yield RecordedEvent(timestamp, strings[type_id],
+                                                    detail1, detail2,
+                                                    strings[any_data_id] or None, source)
+                        else:
+                                raise ValueError("corrupt pyatspi event log")
+
+        def replay(self, registry, speed=None):
+                """
+                Feeds the logged events to the listeners of a registry, through the
+                same path as live events. They are not logged again by a recorder
+                running on the registry.
+
+                @param registry: Registry whose listeners receive the events
+                @type registry: L{Registry}
+                @param speed: Replay speed relative to the recording, e.g. 1.0 to keep
+                        the original pacing. None replays as fast as possible.
+                @type speed: float
+                @return: Number of events replayed
+                @rtype: integer
+                """
+                if not registry.has_implementations:
+                        registry._set_default_registry()
+                count = 0
+                first = None
+                # immune to changes of the wall clock during the replay
+                origin = time.monotonic()
+                for event in self:
+                        if speed:
+                                if first is None:
+                                        first = event.timestamp
+                                delay = (event.timestamp - first) / speed - (time.monotonic() - origin)
+                                if delay > 0:
+                                        time.sleep(delay)
+                        registry._deliverEvent(event)
+                        count += 1
+                return count
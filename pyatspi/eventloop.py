@@ -0,0 +1,184 @@
+#This library is free software; you can redistribute it and/or
+#modify it under the terms of the GNU Lesser General Public
+#License version 2 as published by the Free Software Foundation.
+
+#This program is distributed in the hope that it will be useful,
+#but WITHOUT ANY WARRANTY; without even the implied warranty of
+#MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#GNU General Public License for more details.
+#You should have received a copy of the GNU Lesser General Public License
+#along with this program; if not, write to the Free Software
+#Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+import asyncio
+import collections
+import math
+import selectors
+import threading
+
+from gi.repository import GLib
+
+__all__ = [
+           "GLibSelector",
+           "GLibEventLoopPolicy",
+           "EventStream",
+           "newEventLoop",
+          ]
+
+#------------------------------------------------------------------------------
+
+class GLibSelector(selectors.DefaultSelector):
+        """
+        Selector for asyncio event loops which also runs the default GLib main
+        context, where libatspi receives D-Bus messages. The selector's own poll
+        fd is watched from GLib, so a single blocking GLib iteration waits for
+        both asyncio and AT-SPI traffic, and AT-SPI events are dispatched from the
+        asyncio thread without a second thread.
+
+        The default main context must not be run by another thread (for instance
+        through L{Registry.start}) at the same time.
+        """
+
+        # GLib sources dispatched per select() before returning to asyncio
+        MAX_DISPATCH = 64
+
+        def __init__(self):
+                super(GLibSelector, self).__init__()
+                self._context = GLib.MainContext.default()
+                self._ready = False
+                self._watch = GLib.io_add_watch(self.fileno(), GLib.PRIORITY_DEFAULT,
+                                                GLib.IOCondition.IN, self._on_ready)
+
+        def _on_ready(self, *args):
+                # wakes up the GLib iteration, and tells select() that asyncio has
+                # work: the watch stays pending as long as it does
+                self._ready = True
+                return True
+
+        def _on_timeout(self):
+                self._timer = None
+                return False
+
+        def select(self, timeout=None):
+                context = self._context
+                self._ready = False
+                if timeout is None or timeout > 0:
+                        self._timer = None
+                        if timeout is not None:
+                                self._timer = GLib.timeout_add(int(math.ceil(timeout * 1000)),
+                                                               self._on_timeout)
+                        context.iteration(True)
+                        if self._timer is not None:
+                                GLib.source_remove(self._timer)
+                                self._timer = None
+                for i in range(self.MAX_DISPATCH):
+                        if self._ready or not context.pending():
+                                break
+                        context.iteration(False)
+                return super(GLibSelector, self).select(0)
+
+        def close(self):
+                if self._watch is not None:
+                        GLib.source_remove(self._watch)
+                        self._watch = None
+                super(GLibSelector, self).close()
+
+def newEventLoop():
+        """
+        Creates an asyncio event loop which also drives the AT-SPI connection,
+        see L{GLibSelector}.
+
+        @rtype: asyncio.AbstractEventLoop
+        """
+        return asyncio.SelectorEventLoop(GLibSelector())
+
+class GLibEventLoopPolicy(asyncio.DefaultEventLoopPolicy):
+        """
+        Event loop policy creating loops with L{newEventLoop}, for use with
+        asyncio.run:
+
+        asyncio.set_event_loop_policy(pyatspi.GLibEventLoopPolicy())
+        asyncio.run(main())
+        """
+
+        def new_event_loop(self):
+                return newEventLoop()
+
+#------------------------------------------------------------------------------
+
+class EventStream(object):
+        """
+        Asynchronous iterator over the events received for some event names,
+        returned by L{Registry.events}:
+
+        async for event in pyatspi.Registry.events('object:state-changed'):
+                ...
+
+        Events are buffered between iterations. When maxsize is reached the
+        oldest buffered event is discarded and counted in dropped. Listeners
+        called from another thread than the one the stream was created in hand
+        the event over through the event loop.
+
+        @ivar dropped: Number of events discarded because the buffer was full
+        @type dropped: integer
+        """
+
+        def __init__(self, registry, names, maxsize=0):
+                self._registry = registry
+                self._names = names
+                self._loop = asyncio.get_running_loop()
+                self._thread = threading.get_ident()
+                self._maxsize = maxsize
+                self._events = collections.deque()
+                self._waiter = None
+                self._closed = False
+                self.dropped = 0
+                registry.registerEventListener(self._on_event, *names)
+
+        def _on_event(self, event):
+                if threading.get_ident() == self._thread:
+                        self._put(event)
+                else:
+                        self._loop.call_soon_threadsafe(self._put, event)
+
+        def _put(self, event):
+                if self._closed:
+                        return
+                if self._maxsize and len(self._events) >= self._maxsize:
+                        self._events.popleft()
+                        self.dropped += 1
+                self._events.append(event)
+                self._wake()
+
+        def _wake(self):
+                waiter, self._waiter = self._waiter, None
+                if waiter is not None and not waiter.done():
+                        waiter.set_result(None)
+
+        def __aiter__(self):
+                return self
+
+        async def __anext__(self):
+                while not self._events:
+                        if self._closed:
+                                raise StopAsyncIteration
+                        self._waiter = self._loop.create_future()
+                        await self._waiter
+                return self._events.popleft()
+
+        def close(self):
+                """
+                Deregisters the stream. Iteration ends once buffered events are
+                consumed.
+                """
+                if self._closed:
+                        return
+                self._closed = True
+                self._registry.deregisterEventListener(self._on_event, *self._names)
+                self._wake()
+
+        async def __aenter__(self):
+                return self
+
+        async def __aexit__(self, *args):
+                self.close()
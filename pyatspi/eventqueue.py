@@ -0,0 +1,374 @@
+#This library is free software; you can redistribute it and/or
+#modify it under the terms of the GNU Lesser General Public
+#License version 2 as published by the Free Software Foundation.
+
+#This program is distributed in the hope that it will be useful,
+#but WITHOUT ANY WARRANTY; without even the implied warranty of
+#MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#GNU General Public License for more details.
+#You should have received a copy of the GNU Lesser General Public License
+#along with this program; if not, write to the Free Software
+#Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+import collections
+import threading
+import traceback
+
+__all__ = [
+           "EventQueue",
+           "QUEUE_BLOCK",
+           "QUEUE_DROP_OLDEST",
+           "QUEUE_DROP_NEWEST",
+           "QUEUE_DROP_BY_PRIORITY",
+           "PRIORITY_LOW",
+           "PRIORITY_NORMAL",
+           "PRIORITY_HIGH",
+           "SCHEDULE_FIFO",
+           "SCHEDULE_STRICT",
+           "SCHEDULE_WEIGHTED",
+           "eventPriority",
+           "setEventPriority",
+          ]
+
+#------------------------------------------------------------------------------
+
+QUEUE_BLOCK = 'block'
+QUEUE_DROP_OLDEST = 'drop-oldest'
+QUEUE_DROP_NEWEST = 'drop-newest'
+QUEUE_DROP_BY_PRIORITY = 'drop-by-priority'
+
+PRIORITY_LOW = 0
+PRIORITY_NORMAL = 1
+PRIORITY_HIGH = 2
+
+SCHEDULE_FIFO = 'fifo'
+SCHEDULE_STRICT = 'strict'
+SCHEDULE_WEIGHTED = 'weighted'
+
+# share of dispatch slots given to each busy lane by SCHEDULE_WEIGHTED
+DEFAULT_WEIGHTS = {
+        PRIORITY_LOW: 1,
+        PRIORITY_NORMAL: 4,
+        PRIORITY_HIGH: 16,
+}
+
+# Event names mapped to the priority of the events they cover, see
+# setEventPriority(). Bulk updates go first when the queue overflows; focus and
+# caret tracking go last.
+_EVENT_PRIORITIES = {
+        'object:children-changed': PRIORITY_LOW,
+        'object:bounds-changed': PRIORITY_LOW,
+        'object:visible-data-changed': PRIORITY_LOW,
+        'object:property-change': PRIORITY_LOW,
+        'object:model-changed': PRIORITY_LOW,
+        'object:text-attributes-changed': PRIORITY_LOW,
+        'object:state-changed:focused': PRIORITY_HIGH,
+        'object:active-descendant-changed': PRIORITY_HIGH,
+        'object:text-caret-moved': PRIORITY_HIGH,
+        'window:activate': PRIORITY_HIGH,
+        'focus': PRIORITY_HIGH,
+}
+
+_priority_cache = {}
+
+def setEventPriority(name, priority):
+        """
+        Sets the priority of the events covered by a full or partial event name.
+        The most specific name wins, so 'object:state-changed:focused' can be
+        given a higher priority than 'object:state-changed'.
+
+        @param name: Full or partial event name
+        @type name: string
+        @param priority: PRIORITY_LOW, PRIORITY_NORMAL or PRIORITY_HIGH. None
+                restores the default, PRIORITY_NORMAL.
+        @type priority: integer
+        """
+        name = name.strip(':')
+        if priority is None:
+                _EVENT_PRIORITIES.pop(name, None)
+        else:
+                _EVENT_PRIORITIES[name] = priority
+        _priority_cache.clear()
+
+def eventPriority(event_type):
+        """
+        Looks up the priority of an event type as set with L{setEventPriority},
+        trying its full name first and then shorter prefixes.
+
+        @param event_type: Parsed event type
+        @type event_type: L{EventType}
+        @return: PRIORITY_LOW, PRIORITY_NORMAL or PRIORITY_HIGH
+        @rtype: integer
+        """
+        try:
+                return _priority_cache[event_type]
+        except KeyError:
+                pass
+        priority = PRIORITY_NORMAL
+        parts = [p for p in (event_type.klass, event_type.major,
+                             event_type.minor, event_type.detail) if p]
+        for i in range(len(parts), 0, -1):
+                try:
+                        priority = _EVENT_PRIORITIES[':'.join(parts[:i])]
+                        break
+                except KeyError:
+                        pass
+        if len(_priority_cache) >= 1024:
+                _priority_cache.clear()
+        _priority_cache[event_type] = priority
+        return priority
+
+def _itemPriority(item):
+        return eventPriority(item[0].type)
+
+#------------------------------------------------------------------------------
+
+class EventQueue(object):
+        """
+        Bounded FIFO between event reception on the main loop and dispatch to
+        local listeners. Items are tuples whose first element is the event.
+
+        Items are kept in one lane (deque) per priority level and carry a
+        sequence number. The schedule decides which lane the next item comes
+        from: SCHEDULE_FIFO keeps arrival order across lanes, SCHEDULE_STRICT
+        always serves the highest priority lane first, and SCHEDULE_WEIGHTED
+        shares dispatch between busy lanes according to their weights, so that
+        low priority events are delayed but never starved.
+
+        @ivar maxsize: Maximum number of queued events
+        @type maxsize: integer
+        @ivar overflow: What to do with an event arriving on a full queue:
+                QUEUE_BLOCK, QUEUE_DROP_OLDEST, QUEUE_DROP_NEWEST, or
+                QUEUE_DROP_BY_PRIORITY to discard the oldest event of the lowest
+                priority (the new one if nothing queued has a lower priority)
+        @type overflow: string
+        @ivar dropped: Number of events discarded because the queue was full
+        @type dropped: integer
+        @ivar dropped_by_type: Map of event type names to numbers of discarded
+                events
+        @type dropped_by_type: dictionary
+        @ivar high_water: Largest number of events queued at once
+        @type high_water: integer
+        @ivar schedule: SCHEDULE_FIFO, SCHEDULE_STRICT or SCHEDULE_WEIGHTED
+        @type schedule: string
+        """
+
+        def __init__(self, maxsize=1024, overflow=QUEUE_DROP_OLDEST, priority=_itemPriority,
+                     schedule=SCHEDULE_FIFO, weights=None):
+                """
+                @param priority: Callable giving the priority of a queued item
+                @type priority: callable
+                @param weights: Map of priorities to weights for SCHEDULE_WEIGHTED,
+                        defaults to DEFAULT_WEIGHTS
+                @type weights: dictionary
+                """
+                if maxsize < 1:
+                        raise ValueError("maxsize must be positive")
+                if overflow not in (QUEUE_BLOCK, QUEUE_DROP_OLDEST, QUEUE_DROP_NEWEST,
+                                    QUEUE_DROP_BY_PRIORITY):
+                        raise ValueError("unknown overflow policy %r" % (overflow,))
+                if schedule not in (SCHEDULE_FIFO, SCHEDULE_STRICT, SCHEDULE_WEIGHTED):
+                        raise ValueError("unknown schedule %r" % (schedule,))
+                self.maxsize = maxsize
+                self.overflow = overflow
+                self.dropped = 0
+                self.dropped_by_type = {}
+                self.high_water = 0
+                self._priority = priority
+                self.schedule = schedule
+                self._weights = dict(DEFAULT_WEIGHTS)
+                if weights:
+                        self._weights.update(weights)
+                self._credits = {}
+                self._lanes = {}
+                self._length = 0
+                self._seq = 0
+                self._closed = False
+                self._lock = threading.Lock()
+                self._not_empty = threading.Condition(self._lock)
+                self._not_full = threading.Condition(self._lock)
+
+        def __len__(self):
+                return self._length
+
+        def full(self):
+                return self._length >= self.maxsize
+
+        def _drop(self, item):
+                self.dropped += 1
+                name = str(item[0].type)
+                self.dropped_by_type[name] = self.dropped_by_type.get(name, 0) + 1
+
+        def _append(self, priority, item):
+                try:
+                        lane = self._lanes[priority]
+                except KeyError:
+                        lane = self._lanes[priority] = collections.deque()
+                lane.append((self._seq, item))
+                self._seq += 1
+                self._length += 1
+                if self._length > self.high_water:
+                        self.high_water = self._length
+
+        def _popOldest(self):
+                # lane whose head arrived first
+                best = None
+                for lane in self._lanes.values():
+                        if lane and (best is None or lane[0][0] < best[0][0]):
+                                best = lane
+                self._length -= 1
+                return best.popleft()[1]
+
+        def _popNext(self):
+                if self.schedule == SCHEDULE_FIFO:
+                        return self._popOldest()
+                busy = [p for p, lane in self._lanes.items() if lane]
+                if self.schedule == SCHEDULE_STRICT:
+                        best = max(busy)
+                else:
+                        # smooth weighted round robin between busy lanes
+                        total = 0
+                        best = None
+                        for p in busy:
+                                weight = self._weights.get(p, 1)
+                                total += weight
+                                credit = self._credits[p] = self._credits.get(p, 0) + weight
+                                if best is None or credit > self._credits[best]:
+                                        best = p
+                        self._credits[best] -= total
+                self._length -= 1
+                return self._lanes[best].popleft()[1]
+
+        def put(self, item):
+                """
+                Appends an item, applying the overflow policy when the queue is full.
+
+                @return: False if the item was discarded
+                @rtype: boolean
+                """
+                priority = self._priority(item)
+                with self._lock:
+                        if self._closed:
+                                return False
+                        if self._length >= self.maxsize:
+                                if self.overflow == QUEUE_DROP_NEWEST:
+                                        self._drop(item)
+                                        return False
+                                elif self.overflow == QUEUE_DROP_OLDEST:
+                                        self._drop(self._popOldest())
+                                elif self.overflow == QUEUE_DROP_BY_PRIORITY:
+                                        lowest = min(p for p, lane in self._lanes.items() if lane)
+                                        if lowest > priority:
+                                                self._drop(item)
+                                                return False
+                                        self._length -= 1
+                                        self._drop(self._lanes[lowest].popleft()[1])
+                                else:
+                                        while self._length >= self.maxsize and not self._closed:
+                                                self._not_full.wait()
+                                        if self._closed:
+                                                return False
+                        self._append(priority, item)
+                        self._not_empty.notify()
+                        return True
+
+        def get(self, block=True):
+                """
+                Removes and returns the next item according to the schedule.
+
+                @param block: Wait for an item if the queue is empty?
+                @type block: boolean
+                @raise IndexError: When the queue is empty and either block is False
+                        or the queue has been closed
+                """
+                with self._lock:
+                        while not self._length:
+                                if self._closed or not block:
+                                        raise IndexError
+                                self._not_empty.wait()
+                        item = self._popNext()
+                        self._not_full.notify()
+                        return item
+
+        def discard(self):
+                """
+                Empties the queue, counting the items as dropped.
+
+                @return: Number of items discarded
+                @rtype: integer
+                """
+                with self._lock:
+                        count = self._length
+                        for lane in self._lanes.values():
+                                while lane:
+                                        self._drop(lane.popleft()[1])
+                        self._length = 0
+                        self._not_full.notify_all()
+                        return count
+
+        def close(self):
+                """
+                Refuses further items and wakes up blocked callers. Items already
+                queued can still be retrieved.
+                """
+                with self._lock:
+                        self._closed = True
+                        self._not_empty.notify_all()
+                        self._not_full.notify_all()
+
+        def getStats(self):
+                """
+                @return: Current length, capacity, overflow policy, high water mark
+                        and drop counters
+                @rtype: dictionary
+                """
+                with self._lock:
+                        return {
+                                "length": self._length,
+                                "maxsize": self.maxsize,
+                                "overflow": self.overflow,
+                                "schedule": self.schedule,
+                                "lanes": dict((p, len(lane)) for p, lane in self._lanes.items()),
+                                "high_water": self.high_water,
+                                "dropped": self.dropped,
+                                "dropped_by_type": dict(self.dropped_by_type),
+                        }
+
+#------------------------------------------------------------------------------
+
+class _Dispatcher(object):
+        """
+        Pool of worker threads draining an L{EventQueue}. Each queued item is
+        passed to the dispatch callable. With a single worker, events reach the
+        listeners in the order they were received.
+        """
+
+        def __init__(self, queue, dispatch, workers=1):
+                self.queue = queue
+                self._dispatch = dispatch
+                self._threads = []
+                for i in range(workers):
+                        thread = threading.Thread(target=self._run,
+                                                  name="pyatspi-dispatch-%d" % i)
+                        thread.daemon = True
+                        self._threads.append(thread)
+                        thread.start()
+
+        def _run(self):
+                while True:
+                        try:
+                                item = self.queue.get()
+                        except IndexError:
+                                return
+                        try:
+                                self._dispatch(*item)
+                        except Exception:
+                                traceback.print_exc()
+
+        def stop(self):
+                """
+                Closes the queue and waits for the workers to dispatch what is left.
+                """
+                self.queue.close()
+                for thread in self._threads:
+                        thread.join()
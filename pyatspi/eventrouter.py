@@ -0,0 +1,177 @@
+#This library is free software; you can redistribute it and/or
+#modify it under the terms of the GNU Lesser General Public
+#License version 2 as published by the Free Software Foundation.
+
+#This program is distributed in the hope that it will be useful,
+#but WITHOUT ANY WARRANTY; without even the implied warranty of
+#MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#GNU General Public License for more details.
+#You should have received a copy of the GNU Lesser General Public License
+#along with this program; if not, write to the Free Software
+#Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+from pyatspi.appevent import EventType
+
+__all__ = [
+           "EventRouter",
+          ]
+
+#------------------------------------------------------------------------------
+
+class _Node(object):
+        __slots__ = ('children', 'clients')
+
+        def __init__(self):
+                self.children = {}
+                # replaced rather than mutated so that routing from a dispatch
+                # thread never sees a half-updated tuple
+                self.clients = ()
+
+class EventRouter(object):
+        """
+        Prefix trie mapping event names to local listeners. Each level of the trie
+        is keyed on one component of the event type (klass, major, minor and
+        detail), and listeners stored on a node receive every event below it, so
+        a listener registered for 'object' receives 'object:state-changed:focused'.
+
+        Routing an event walks at most four levels and returns the listeners found
+        along the path, making its cost independent of the total number of
+        registrations.
+        """
+
+        def __init__(self):
+                self._root = _Node()
+                # client -> number of names it is registered for
+                self._registrations = {}
+
+        @staticmethod
+        def _path(name):
+                event_type = EventType.intern(name)
+                path = []
+                for part in (event_type.klass, event_type.major,
+                             event_type.minor, event_type.detail):
+                        if not part:
+                                break
+                        path.append(part)
+                return tuple(path)
+
+        @classmethod
+        def canonical(cls, name):
+                """
+                @param name: Full or partial event name
+                @type name: string
+                @return: The name without empty or trailing components, as used for
+                        native subscriptions
+                @rtype: string
+                """
+                if isinstance(name, tuple):
+                        return EventType._SEPARATOR.join(name)
+                return EventType._SEPARATOR.join(cls._path(name))
+
+        def add(self, client, name):
+                """
+                Registers a client for an event name.
+
+                @param client: Callable to be invoked when the event occurs
+                @type client: callable
+                @param name: Full or partial event name
+                @type name: string
+                @return: Is this the first client registered for this name, meaning
+                        that a native subscription for L{canonical}(name) is needed?
+                @rtype: boolean
+                """
+                path = self._path(name)
+                node = self._root
+                for part in path:
+                        child = node.children.get(part)
+                        if child is None:
+                                child = node.children[part] = _Node()
+                        node = child
+                if client in node.clients:
+                        return False
+                first = not node.clients
+                node.clients = node.clients + (client,)
+                self._registrations[client] = self._registrations.get(client, 0) + 1
+                return first
+
+        def remove(self, client, name):
+                """
+                Unregisters a client for an event name and all of its subevents.
+
+                @return: A pair (registered, released): whether the client was
+                        registered for the name or one of its subevents, and the list
+                        of names left without any client, whose native subscriptions
+                        can be dropped.
+                @rtype: tuple
+                """
+                path = self._path(name)
+                nodes = [self._root]
+                for part in path:
+                        node = nodes[-1].children.get(part)
+                        if node is None:
+                                return (False, [])
+                        nodes.append(node)
+                registered = False
+                released = []
+                stack = [(nodes[-1], path)]
+                while stack:
+                        node, node_path = stack.pop()
+                        if client in node.clients:
+                                registered = True
+                                node.clients = tuple(c for c in node.clients if c != client)
+                                self._unregister(client)
+                                if not node.clients:
+                                        released.append(self.canonical(node_path))
+                        stack.extend((child, node_path + (part,))
+                                     for part, child in node.children.items())
+                # prune empty branches
+                self._prune(nodes[-1])
+                for i in range(len(path), 0, -1):
+                        node = nodes[i]
+                        if node.clients or node.children:
+                                break
+                        del nodes[i - 1].children[path[i - 1]]
+                return (registered, released)
+
+        def _unregister(self, client):
+                count = self._registrations[client] - 1
+                if count:
+                        self._registrations[client] = count
+                else:
+                        del self._registrations[client]
+
+        def _prune(self, node):
+                for part, child in list(node.children.items()):
+                        self._prune(child)
+                        if not child.clients and not child.children:
+                                del node.children[part]
+
+        def route(self, event_type):
+                """
+                Finds the clients interested in an event.
+
+                @param event_type: Parsed type of the received event
+                @type event_type: L{EventType}
+                @return: Matching clients, each listed once, most general
+                        registrations first
+                @rtype: list
+                """
+                node = self._root
+                # ordered set: a client found again keeps its first position
+                clients = dict.fromkeys(node.clients)
+                for part in (event_type.klass, event_type.major,
+                             event_type.minor, event_type.detail):
+                        if not part:
+                                break
+                        node = node.children.get(part)
+                        if node is None:
+                                break
+                        clients.update(dict.fromkeys(node.clients))
+                return list(clients)
+
+        def __contains__(self, client):
+                """
+                @return: Is the client registered for any event name?
+                @rtype: boolean
+                """
+                return client in self._registrations
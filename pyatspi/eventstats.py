@@ -0,0 +1,160 @@
+#This library is free software; you can redistribute it and/or
+#modify it under the terms of the GNU Lesser General Public
+#License version 2 as published by the Free Software Foundation.
+
+#This program is distributed in the hope that it will be useful,
+#but WITHOUT ANY WARRANTY; without even the implied warranty of
+#MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#GNU General Public License for more details.
+#You should have received a copy of the GNU Lesser General Public License
+#along with this program; if not, write to the Free Software
+#Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+import json
+import math
+import threading
+import time
+
+__all__ = [
+           "LatencyHistogram",
+           "EventStats",
+          ]
+
+#------------------------------------------------------------------------------
+
+class LatencyHistogram(object):
+        """
+        Log-linear histogram of durations, in the spirit of HDR histograms: each
+        power of two of microseconds is split into SUB_BUCKETS linear buckets, so
+        the relative error of a recorded value is bounded by 1/SUB_BUCKETS
+        whatever its magnitude.
+        """
+
+        SUB_BUCKETS = 8
+
+        def __init__(self):
+                self.count = 0
+                self.total = 0.0
+                self.max = 0.0
+                self._buckets = {}
+
+        def _index(self, usec):
+                if usec < 1.0:
+                        return 0
+                mantissa, exponent = math.frexp(usec)
+                # mantissa is in [0.5, 1)
+                return exponent * self.SUB_BUCKETS + int((mantissa - 0.5) * 2 * self.SUB_BUCKETS)
+
+        def _upper(self, index):
+                if index == 0:
+                        return 1.0
+                exponent, sub = divmod(index, self.SUB_BUCKETS)
+                return math.ldexp(0.5 + (sub + 1) / (2.0 * self.SUB_BUCKETS), exponent)
+
+        def record(self, seconds):
+                usec = seconds * 1e6
+                self.count += 1
+                self.total += seconds
+                if seconds > self.max:
+                        self.max = seconds
+                index = self._index(usec)
+                self._buckets[index] = self._buckets.get(index, 0) + 1
+
+        def percentile(self, p):
+                """
+                @param p: Percentile, between 0 and 100
+                @type p: float
+                @return: Upper bound in seconds of the bucket holding the percentile
+                @rtype: float
+                """
+                if not self.count:
+                        return 0.0
+                wanted = self.count * p / 100.0
+                seen = 0
+                for index in sorted(self._buckets):
+                        seen += self._buckets[index]
+                        if seen >= wanted:
+                                return min(self._upper(index) / 1e6, self.max)
+                return self.max
+
+        def toDict(self):
+                return {
+                        "count": self.count,
+                        "total": self.total,
+                        "mean": self.total / self.count if self.count else 0.0,
+                        "max": self.max,
+                        "p50": self.percentile(50),
+                        "p90": self.percentile(90),
+                        "p99": self.percentile(99),
+                        "p999": self.percentile(99.9),
+                        # bucket upper bound in microseconds -> count
+                        "buckets": [[self._upper(i), self._buckets[i]]
+                                    for i in sorted(self._buckets)],
+                }
+
+#------------------------------------------------------------------------------
+
+def _clientName(client):
+        name = getattr(client, '__qualname__', None) or getattr(client, '__name__', None)
+        if name is None:
+                return repr(client)
+        module = getattr(client, '__module__', None)
+        if module:
+                name = module + '.' + name
+        return '%s@%x' % (name, id(client))
+
+class EventStats(object):
+        """
+        Dispatch statistics gathered by the L{Registry} when enabled with
+        L{Registry.setStatsEnabled}: per client call counts and latency
+        histograms, and per event type arrival counts and rates.
+        """
+
+        def __init__(self):
+                self.started = time.time()
+                self._lock = threading.Lock()
+                self._clients = {}
+                self._arrivals = {}
+
+        def recordArrival(self, event_type):
+                with self._lock:
+                        self._arrivals[event_type] = self._arrivals.get(event_type, 0) + 1
+
+        def recordCall(self, client, seconds):
+                with self._lock:
+                        try:
+                                histogram = self._clients[client]
+                        except KeyError:
+                                histogram = self._clients[client] = LatencyHistogram()
+                        histogram.record(seconds)
+
+        def toDict(self):
+                """
+                @return: Snapshot of the statistics, made of JSON serializable types.
+                        Clients are sorted by decreasing cumulative time.
+                @rtype: dictionary
+                """
+                with self._lock:
+                        elapsed = max(time.time() - self.started, 1e-9)
+                        clients = sorted(self._clients.items(),
+                                         key=lambda item: item[1].total, reverse=True)
+                        return {
+                                "elapsed": elapsed,
+                                "listeners": [dict(histogram.toDict(), name=_clientName(client))
+                                              for client, histogram in clients],
+                                "events": dict((str(event_type),
+                                                {"count": count, "rate": count / elapsed})
+                                               for event_type, count in self._arrivals.items()),
+                        }
+
+        def dump(self, fp=None, **kwargs):
+                """
+                Serializes L{toDict} as JSON.
+
+                @param fp: File to write to, or None to return a string
+                @type fp: file
+                @param kwargs: Passed to json.dump
+                """
+                if fp is None:
+                        return json.dumps(self.toDict(), **kwargs)
+                json.dump(self.toDict(), fp, **kwargs)
@@ -0,0 +1,303 @@
+#This library is free software; you can redistribute it and/or
+#modify it under the terms of the GNU Lesser General Public
+#License version 2 as published by the Free Software Foundation.
+
+#This program is distributed in the hope that it will be useful,
+#but WITHOUT ANY WARRANTY; without even the implied warranty of
+#MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#GNU General Public License for more details.
+#You should have received a copy of the GNU Lesser General Public License
+#along with this program; if not, write to the Free Software
+#Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+import threading
+
+from pyatspi.eventfilter import EventFilter
+from pyatspi.registry import Registry
+from pyatspi.state import STATE_VALUE_TO_NAME
+from pyatspi.utils import _busName, _children
+
+__all__ = [
+           "MirrorNode",
+           "TreeMirror",
+          ]
+
+#------------------------------------------------------------------------------
+
+FIELDS = ('role', 'states', 'name', 'description')
+
+# state names as they appear in object:state-changed events
+_STATES = dict((name.replace(' ', '-'), int(value))
+               for value, name in STATE_VALUE_TO_NAME.items())
+
+_PROPERTIES = {
+        'accessible-name': 'name',
+        'accessible-description': 'description',
+        'accessible-role': 'role',
+}
+
+_EVENTS = ('object:children-changed', 'object:property-change', 'object:state-changed')
+
+def _fetch(acc, field):
+        try:
+                if field == 'role':
+                        return int(acc.getRole())
+                elif field == 'states':
+                        return acc.getState().states
+                elif field == 'name':
+                        return acc.name or ''
+                else:
+                        return acc.description or ''
+        except Exception:
+                return 0 if field in ('role', 'states') else ''
+
+class MirrorNode(object):
+        """
+        Local copy of one accessible in a L{TreeMirror}. Fields which were not
+        mirrored are None.
+        """
+        __slots__ = ('accessible', 'parent', 'children',
+                     'role', 'states', 'name', 'description')
+
+        def __init__(self, accessible, parent):
+                self.accessible = accessible
+                self.parent = parent
+                self.children = []
+                self.role = self.states = self.name = self.description = None
+
+        def hasState(self, state):
+                return bool(self.states >> int(state) & 1)
+
+class TreeMirror(object):
+        """
+        Copy of an accessible subtree kept up to date from events. The subtree is
+        walked once; afterwards object:state-changed and
+        object:property-change events update the mirrored fields without any
+        remote call. object:children-changed events drop the subtree of a
+        removed child at once; an added child, or an event which cannot be
+        applied as is, marks the parent dirty, and only its children are fetched
+        again by L{refresh}, so no subtree is walked inside the event callback.
+        When the registry drops events because its queue overflowed, the mirror
+        cannot tell what it missed: refresh then walks the whole subtree again.
+
+        Events may be delivered on dispatcher threads (see L{Registry.start}):
+        the mirror is locked while it applies an event or refreshes, so a
+        refresh holds events back until its remote calls are done.
+
+        @ivar root: Mirror of the root accessible
+        @type root: L{MirrorNode}
+        @ivar events: Number of events applied
+        @type events: integer
+        @ivar fetched: Number of nodes fetched from the application, including
+                the initial walk
+        @type fetched: integer
+        """
+
+        def __init__(self, root, fields=('role', 'states', 'name'), registry=None):
+                """
+                @param root: Root of the subtree to mirror
+                @type root: Accessibility.Accessible
+                @param fields: Fields to mirror, among 'role', 'states', 'name' and
+                        'description'
+                @type fields: sequence of string
+                @param registry: Registry delivering the events, defaults to
+                        pyatspi.Registry
+                @type registry: L{Registry}
+                @raise ValueError: When a field is unknown
+                """
+                for field in fields:
+                        if field not in FIELDS:
+                                raise ValueError("unknown mirror field %r" % (field,))
+                self.fields = tuple(fields)
+                self.events = 0
+                self.fetched = 0
+                self._nodes = {}
+                self._dirty = set()
+                self._stale = False
+                self._lock = threading.RLock()
+                self._registry = registry or Registry()
+                self._dropped = self._registry.getDroppedCount()
+                self.root = self._load(root, None)
+                event_filter = None
+                bus_name = _busName(root)
+                if bus_name is not None:
+                        event_filter = EventFilter(applications=bus_name)
+                self._registry.registerEventListener(self._onEvent, *_EVENTS,
+                                                     filter=event_filter)
+
+        def __len__(self):
+                with self._lock:
+                        return len(self._nodes)
+
+        def getNode(self, acc):
+                """
+                @return: Mirror of an accessible, or None if it is not in the subtree
+                        or was added since the last L{refresh}
+                @rtype: L{MirrorNode}
+                """
+                with self._lock:
+                        return self._nodes.get(acc)
+
+        def close(self):
+                """
+                Stops following events.
+                """
+                self._registry.deregisterEventListener(self._onEvent, *_EVENTS)
+
+        def _load(self, acc, parent):
+                """
+                Walks the subtree of acc into new nodes.
+                """
+                top = MirrorNode(acc, parent)
+                stack = [top]
+                while stack:
+                        node = stack.pop()
+                        self._nodes[node.accessible] = node
+                        self.fetched += 1
+                        for field in self.fields:
+                                setattr(node, field, _fetch(node.accessible, field))
+                        for child in _children(node.accessible):
+                                if child is None or child in self._nodes:
+                                        continue
+                                child_node = MirrorNode(child, node)
+                                node.children.append(child_node)
+                                stack.append(child_node)
+                return top
+
+        def _drop(self, node):
+                stack = [node]
+                while stack:
+                        node = stack.pop()
+                        if self._nodes.get(node.accessible) is node:
+                                del self._nodes[node.accessible]
+                        self._dirty.discard(node)
+                        stack.extend(node.children)
+
+        def _missedEvents(self):
+                dropped = self._registry.getDroppedCount()
+                if dropped != self._dropped:
+                        self._dropped = dropped
+                        self._stale = True
+                return self._stale
+
+        def _onEvent(self, event):
+                with self._lock:
+                        self._apply(event)
+
+        def _apply(self, event):
+                if self._missedEvents():
+                        # left for refresh to walk again
+                        return
+                node = self._nodes.get(event.source)
+                if node is None:
+                        return
+                self.events += 1
+                event_type = event.type
+                if event_type.major == 'children-changed':
+                        self._childrenChanged(node, event)
+                elif event_type.major == 'state-changed':
+                        state = _STATES.get(event_type.minor)
+                        if node.states is None or state is None:
+                                return
+                        if event.detail1:
+                                node.states |= 1 << state
+                        else:
+                                node.states &= ~(1 << state)
+                elif event_type.major == 'property-change':
+                        field = _PROPERTIES.get(event_type.minor)
+                        if field is None or field not in self.fields:
+                                return
+                        if field != 'role' and isinstance(event.any_data, str):
+                                setattr(node, field, event.any_data)
+                        else:
+                                setattr(node, field, _fetch(node.accessible, field))
+
+        def _childrenChanged(self, node, event):
+                child = event.any_data
+                minor = event.type.minor
+                if minor == 'remove':
+                        child_node = self._nodes.get(child)
+                        if child_node is None or child_node.parent is not node:
+                                self._dirty.add(node)
+                                return
+                        node.children.remove(child_node)
+                        self._drop(child_node)
+                else:
+                        self._dirty.add(node)
+
+        def refresh(self):
+                """
+                Fetches again the children of the nodes marked dirty. Children which
+                are still there keep their mirrored subtree; new ones are walked.
+                After events were dropped, the whole subtree is walked again.
+
+                @return: Number of nodes refreshed
+                @rtype: integer
+                """
+                with self._lock:
+                        return self._refresh()
+
+        def _refresh(self):
+                if self._missedEvents():
+                        self._stale = False
+                        self._nodes = {}
+                        self._dirty = set()
+                        fetched = self.fetched
+                        self.root = self._load(self.root.accessible, None)
+                        return self.fetched - fetched
+                dirty, self._dirty = self._dirty, set()
+                refreshed = 0
+                for node in dirty:
+                        if self._nodes.get(node.accessible) is not node:
+                                # dropped with an ancestor refreshed before it
+                                continue
+                        refreshed += 1
+                        live = [child for child in _children(node.accessible)
+                                if child is not None]
+                        kept = dict((child.accessible, child) for child in node.children)
+                        children = []
+                        for child in live:
+                                child_node = kept.pop(child, None)
+                                if child_node is None:
+                                        if child in self._nodes:
+                                                # moved from elsewhere in the tree
+                                                self._drop(self._nodes[child])
+                                        child_node = self._load(child, node)
+                                children.append(child_node)
+                        for child_node in kept.values():
+                                self._drop(child_node)
+                        node.children = children
+                self.fetched += refreshed
+                return refreshed
+
+        def check(self):
+                """
+                Compares the mirror with a fresh walk of the application, after
+                applying pending refreshes. Meant for tests and debugging: it costs
+                a full walk.
+
+                @return: Differences found, as tuples (accessible, field, mirrored
+                        value, live value), field being 'children' for structural
+                        differences
+                @rtype: list
+                """
+                with self._lock:
+                        return self._check()
+
+        def _check(self):
+                self._refresh()
+                differences = []
+                stack = [self.root]
+                while stack:
+                        node = stack.pop()
+                        acc = node.accessible
+                        for field in self.fields:
+                                live = _fetch(acc, field)
+                                if getattr(node, field) != live:
+                                        differences.append((acc, field, getattr(node, field), live))
+                        mirrored = [child.accessible for child in node.children]
+                        live = [child for child in _children(acc) if child is not None]
+                        if mirrored != live:
+                                differences.append((acc, 'children', mirrored, live))
+                        stack.extend(node.children)
+                return differences
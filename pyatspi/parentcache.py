@@ -0,0 +1,151 @@
+#This library is free software; you can redistribute it and/or
+#modify it under the terms of the GNU Lesser General Public
+#License version 2 as published by the Free Software Foundation.
+
+#This program is distributed in the hope that it will be useful,
+#but WITHOUT ANY WARRANTY; without even the implied warranty of
+#MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#GNU General Public License for more details.
+#You should have received a copy of the GNU Lesser General Public License
+#along with this program; if not, write to the Free Software
+#Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+import threading
+
+from pyatspi.cachestats import registerCache
+
+__all__ = [
+           "ParentCache",
+          ]
+
+#------------------------------------------------------------------------------
+
+class ParentCache(object):
+        """
+        Memo of the parent and index in parent of accessibles, used by L{getPath}
+        and L{findAncestor} once enabled with L{setParentCacheEnabled}. After the
+        first walk up from an object, later walks through the same ancestors are
+        local lookups.
+
+        Entries are dropped on the events which can make them wrong:
+        object:children-changed on a parent forgets the indices of all its
+        children, and object:property-change:accessible-parent forgets the
+        source. The memo is only correct while these events are received, that
+        is while the main loop runs. When the registry drops events because its
+        queue overflowed, the memo cannot tell which entries went stale and is
+        emptied.
+
+        Counters are reported under 'parents' by L{printCache}.
+        """
+
+        EVENTS = ('object:children-changed', 'object:property-change:accessible-parent')
+
+        # entries kept before the memo is emptied
+        MAX_ENTRIES = 65536
+
+        def __init__(self, registry=None):
+                """
+                @param registry: Registry delivering the events, whose count of
+                        dropped events is watched
+                @type registry: L{Registry}
+                """
+                self._registry = registry
+                self._dropped = registry.getDroppedCount() if registry is not None else 0
+                # accessible -> [parent, index in parent or None if not fetched yet]
+                self._entries = {}
+                # parent -> set of children with an entry
+                self._children = {}
+                self._lock = threading.Lock()
+                self.counter = registerCache('parents', self.clear, self.__len__)
+
+        def __len__(self):
+                return len(self._entries)
+
+        def lookup(self, acc, with_index=False):
+                """
+                @param acc: Accessible to look up
+                @type acc: Accessibility.Accessible
+                @param with_index: Is the index in parent needed?
+                @type with_index: boolean
+                @return: Parent of acc and, if with_index is True and acc has a
+                        parent, its index in that parent (None otherwise)
+                @rtype: tuple
+                """
+                self._checkDropped()
+                entry = self._entries.get(acc)
+                if entry is not None and (not with_index or entry[0] is None or
+                                          entry[1] is not None):
+                        self.counter.hit()
+                        return (entry[0], entry[1])
+                self.counter.miss()
+                parent = entry[0] if entry is not None else acc.parent
+                index = None
+                if with_index and parent is not None:
+                        index = acc.getIndexInParent()
+                with self._lock:
+                        if len(self._entries) >= self.MAX_ENTRIES:
+                                self.counter.evict(self._clear())
+                        self._entries[acc] = [parent, index]
+                        if parent is not None:
+                                self._children.setdefault(parent, set()).add(acc)
+                return (parent, index)
+
+        def invalidate(self, acc):
+                """
+                Forgets the parent and index of an accessible.
+                """
+                with self._lock:
+                        self._forget(acc)
+
+        def invalidateChildren(self, parent):
+                """
+                Forgets the parent and index of all the children of an accessible.
+                """
+                with self._lock:
+                        for child in self._children.pop(parent, ()):
+                                self._entries.pop(child, None)
+
+        def _forget(self, acc):
+                entry = self._entries.pop(acc, None)
+                if entry is not None and entry[0] is not None:
+                        siblings = self._children.get(entry[0])
+                        if siblings is not None:
+                                siblings.discard(acc)
+
+        def _checkDropped(self):
+                registry = self._registry
+                if registry is None:
+                        return
+                dropped = registry.getDroppedCount()
+                if dropped != self._dropped:
+                        with self._lock:
+                                self._dropped = dropped
+                                self.counter.evict(self._clear())
+
+        def _onEvent(self, event):
+                self._checkDropped()
+                if event.type.major == 'children-changed':
+                        self.invalidateChildren(event.source)
+                        child = event.any_data
+                        if child is not None:
+                                try:
+                                        self.invalidate(child)
+                                except TypeError:
+                                        # any_data of an unexpected, unhashable kind
+                                        pass
+                else:
+                        self.invalidate(event.source)
+
+        def _clear(self):
+                count = len(self._entries)
+                self._entries.clear()
+                self._children.clear()
+                return count
+
+        def clear(self):
+                """
+                @return: Number of entries dropped
+                @rtype: integer
+                """
+                with self._lock:
+                        return self._clear()
@@ -0,0 +1,408 @@
+#This library is free software; you can redistribute it and/or
+#modify it under the terms of the GNU Lesser General Public
+#License version 2 as published by the Free Software Foundation.
+
+#This program is distributed in the hope that it will be useful,
+#but WITHOUT ANY WARRANTY; without even the implied warranty of
+#MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#GNU General Public License for more details.
+#You should have received a copy of the GNU Lesser General Public License
+#along with this program; if not, write to the Free Software
+#Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+import collections
+import concurrent.futures
+import os
+
+from gi.repository import Atspi
+from gi.repository import Gio
+from gi.repository import GLib
+
+__all__ = [
+           "AccessibleReference",
+           "Pipeline",
+          ]
+
+#------------------------------------------------------------------------------
+
+ACCESSIBLE = 'org.a11y.atspi.Accessible'
+COMPONENT = 'org.a11y.atspi.Component'
+TEXT = 'org.a11y.atspi.Text'
+PROPERTIES = 'org.freedesktop.DBus.Properties'
+
+# fields read with Properties.Get on the Accessible interface
+_PROPERTIES = {
+        'name': 'Name',
+        'description': 'Description',
+        'childCount': 'ChildCount',
+}
+
+# fields read with an Accessible method, and the conversion of the reply
+_METHODS = {
+        'getRole': ('GetRole', Atspi.Role),
+        'getRoleName': ('GetRoleName', None),
+        'getLocalizedRoleName': ('GetLocalizedRoleName', None),
+        'getIndexInParent': ('GetIndexInParent', None),
+        'getAttributes': ('GetAttributes',
+                          lambda attributes: ['%s:%s' % item for item in attributes.items()]),
+}
+
+def _boundingBox(extents):
+        from pyatspi.utils import BoundingBox
+        return BoundingBox(*extents)
+
+# fields taking arguments, given as a tuple (name, arguments...): the
+# interface and method called, the signature of the arguments, the conversion
+# of the reply and the query giving the interface through libatspi
+_INTERFACE_METHODS = {
+        'getExtents': (COMPONENT, 'GetExtents', '(u)', _boundingBox, 'queryComponent'),
+        'getText': (TEXT, 'GetText', '(ii)', None, 'queryText'),
+}
+
+def _resolve(obj, field):
+        """
+        Reads one field of an object: a callable is called with the object, an
+        attribute name gives the attribute, which is called when it is a method
+        ('name', 'getRole', 'childCount'...), and a tuple (name, arguments...)
+        calls that method of the object or of its interface.
+        """
+        if callable(field):
+                return field(obj)
+        if isinstance(field, tuple):
+                name, args = field[0], field[1:]
+                method = _INTERFACE_METHODS.get(name)
+                if method is not None:
+                        obj = getattr(obj, method[4])()
+                return getattr(obj, name)(*args)
+        value = getattr(obj, field)
+        if callable(value):
+                return value()
+        return value
+
+def _resolved(obj, field):
+        """
+        Reads a field through libatspi, in the caller's thread.
+
+        @return: Completed future for the value
+        """
+        future = concurrent.futures.Future()
+        try:
+                future.set_result(_resolve(obj, field))
+        except Exception as e:
+                future.set_exception(e)
+        return future
+
+def _address(obj):
+        try:
+                return obj.app.bus_name, obj.path
+        except AttributeError:
+                return getattr(obj, 'bus_name', None), getattr(obj, 'path', None)
+
+def _a11yBus():
+        """
+        Opens a connection of our own to the accessibility bus.
+        """
+        address = os.environ.get('AT_SPI_BUS_ADDRESS')
+        if not address:
+                session = Gio.bus_get_sync(Gio.BusType.SESSION, None)
+                reply = session.call_sync('org.a11y.Bus', '/org/a11y/bus', 'org.a11y.Bus',
+                                          'GetAddress', None, GLib.VariantType('(s)'),
+                                          Gio.DBusCallFlags.NONE, -1, None)
+                address, = reply.unpack()
+        return Gio.DBusConnection.new_for_address_sync(
+                address,
+                Gio.DBusConnectionFlags.AUTHENTICATION_CLIENT |
+                Gio.DBusConnectionFlags.MESSAGE_BUS_CONNECTION,
+                None, None)
+
+class AccessibleReference(object):
+        """
+        Address of an accessible on the bus, as given by searches which do not
+        go through libatspi (see L{findAllDescendantsParallel}). A L{Pipeline}
+        reads its fields like those of an accessible.
+
+        @ivar bus_name: D-Bus name of the application the accessible belongs to
+        @type bus_name: string
+        @ivar path: D-Bus object path of the accessible
+        @type path: string
+        """
+
+        def __init__(self, bus_name, path):
+                self.bus_name = bus_name
+                self.path = path
+
+        def __eq__(self, other):
+                return (isinstance(other, AccessibleReference) and
+                        self.bus_name == other.bus_name and self.path == other.path)
+
+        def __ne__(self, other):
+                return not self.__eq__(other)
+
+        def __hash__(self):
+                return hash((self.bus_name, self.path))
+
+        def __str__(self):
+                return '[%s %s]' % (self.bus_name, self.path)
+
+class _Batch(object):
+        """
+        Calls started by one fetch: the context their replies are dispatched
+        from, how many are in flight and those waiting for a free slot.
+        """
+
+        def __init__(self, context):
+                self.context = context
+                self.in_flight = 0
+                self.waiting = collections.deque()
+
+class Pipeline(object):
+        """
+        Keeps many accessor calls in flight at once. Every pyatspi accessor is a
+        blocking D-Bus round-trip; a pipeline sends the requests for the common
+        fields ('name', 'description', 'childCount', 'getRole', 'getRoleName',
+        'getLocalizedRoleName', 'getIndexInParent' and 'getAttributes') and for
+        the extents and text, given with their arguments as ('getExtents',
+        coord_type) and ('getText', start, end), as asynchronous D-Bus calls
+        from the caller's thread and then collects the replies, so reading the
+        names and roles of a whole window costs about one round-trip per depth
+        objects instead of one per object.
+
+        pipeline = pyatspi.Pipeline()
+        for name, role in pipeline.fetch(frame, 'name', 'getRoleName'):
+                ...
+
+        Calls of different kinds can be overlapped with L{submit}, which gives
+        one future per call:
+
+        extents = pipeline.submit(button, ('getExtents', pyatspi.DESKTOP_COORDS))
+        text = pipeline.submit(entry, ('getText', 0, -1))
+        pipeline.wait((extents, text))
+
+        The calls go through a connection of the pipeline's own and never enter
+        libatspi, which is not thread-safe. Other fields are read through
+        libatspi, one after the other, in the caller's thread.
+        """
+
+        def __init__(self, depth=64, timeout=-1):
+                """
+                @param depth: Maximum number of calls in flight
+                @type depth: integer
+                @param timeout: Timeout of each call in milliseconds, -1 for the D-Bus
+                        default
+                @type timeout: integer
+                """
+                self._depth = depth
+                self._timeout = timeout
+                self._connection = None
+                # replies to blocking fetches are dispatched here, away from the
+                # default context and the events libatspi receives there
+                self._context = GLib.MainContext()
+                # calls made with submit, whose replies are dispatched from the
+                # default context
+                self._submitted = None
+
+        def _bus(self):
+                if self._connection is None:
+                        try:
+                                self._connection = _a11yBus()
+                        except GLib.Error:
+                                # no bus of our own: everything goes through libatspi
+                                self._connection = False
+                return self._connection
+
+        def _request(self, obj, field):
+                """
+                @return: D-Bus call reading the field as a tuple (bus name, path,
+                        interface, method, arguments, conversion), or None when the
+                        field has to be read through libatspi
+                """
+                if isinstance(field, tuple):
+                        method = _INTERFACE_METHODS.get(field[0])
+                        if method is None:
+                                return None
+                elif not isinstance(field, str):
+                        return None
+                bus_name, path = _address(obj)
+                if not bus_name or not path or not self._bus():
+                        return None
+                if isinstance(field, tuple):
+                        interface, name, signature, convert = method[:4]
+                        return (bus_name, path, interface, name,
+                                GLib.Variant(signature, tuple(int(arg) for arg in field[1:])),
+                                convert)
+                prop = _PROPERTIES.get(field)
+                if prop is not None:
+                        return (bus_name, path, PROPERTIES, 'Get',
+                                GLib.Variant('(ss)', (ACCESSIBLE, prop)), None)
+                method = _METHODS.get(field)
+                if method is not None:
+                        return (bus_name, path, ACCESSIBLE, method[0], None, method[1])
+                return None
+
+        def _start(self, batch, request, future):
+                bus_name, path, interface, method, args, convert = request
+                batch.context.push_thread_default()
+                try:
+                        self._connection.call(bus_name, path, interface, method, args, None,
+                                              Gio.DBusCallFlags.NO_AUTO_START, self._timeout,
+                                              None, self._onReply, (batch, future, convert))
+                except Exception as e:
+                        future.set_exception(e)
+                        return
+                finally:
+                        batch.context.pop_thread_default()
+                batch.in_flight += 1
+
+        def _onReply(self, connection, result, data):
+                batch, future, convert = data
+                batch.in_flight -= 1
+                try:
+                        value = connection.call_finish(result).unpack()[0]
+                        if convert is not None:
+                                value = convert(value)
+                except Exception as e:
+                        future.set_exception(e)
+                else:
+                        future.set_result(value)
+                while batch.waiting and batch.in_flight < self._depth:
+                        self._start(batch, *batch.waiting.popleft())
+
+        def _call(self, batch, obj, field):
+                """
+                Starts reading a field of an object, or queues the call when depth
+                calls are in flight.
+
+                @return: Future for the value
+                """
+                try:
+                        request = self._request(obj, field)
+                except Exception:
+                        request = None
+                if request is None:
+                        return _resolved(obj, field)
+                future = concurrent.futures.Future()
+                if batch.in_flight < self._depth:
+                        self._start(batch, request, future)
+                else:
+                        batch.waiting.append((request, future))
+                return future
+
+        def _submit(self, objects, fields, batch):
+                """
+                Starts reading fields of objects, at most depth calls at a time.
+
+                @return: One list of futures per object
+                """
+                return [[self._call(batch, obj, field) for field in fields]
+                        for obj in objects]
+
+        def _defaultBatch(self):
+                if self._submitted is None:
+                        self._submitted = _Batch(GLib.MainContext.default())
+                return self._submitted
+
+        def submit(self, obj, field, callback=None):
+                """
+                Starts reading a field of an object and returns at once. Calls
+                submitted this way share the depth limit, whatever their kind, and
+                their replies are dispatched from the default main context: by the
+                running GLib or asyncio loop, or by L{wait}.
+
+                @param obj: Object to read from, usually an Accessible
+                @type obj: object
+                @param field: Field to read, see L{get}
+                @param callback: Called with the future once it is done
+                @type callback: callable
+                @return: Future for the value
+                @rtype: concurrent.futures.Future
+                """
+                future = self._call(self._defaultBatch(), obj, field)
+                if callback is not None:
+                        future.add_done_callback(callback)
+                return future
+
+        def wait(self, futures):
+                """
+                Dispatches the default main context until submitted calls are done,
+                for callers which do not run a main loop.
+
+                @param futures: Futures given by L{submit}
+                @type futures: iterable
+                """
+                context = GLib.MainContext.default()
+                for future in futures:
+                        while not future.done():
+                                context.iteration(True)
+
+        def get(self, obj, field):
+                """
+                Reads a field of an object.
+
+                @param obj: Object to read from, usually an Accessible
+                @type obj: object
+                @param field: Attribute or method name, called without arguments if
+                        it is a method, tuple of a method name and its arguments, or
+                        callable taking the object
+                @type field: string, tuple or callable
+                @return: Value of the field
+                @raise Exception: When the call failed
+                """
+                batch = _Batch(self._context)
+                pending = self._submit((obj,), (field,), batch)
+                self._wait(batch)
+                return pending[0][0].result()
+
+        def _wait(self, batch):
+                while batch.in_flight:
+                        batch.context.iteration(True)
+
+        def fetch(self, objects, *fields, default=None):
+                """
+                Reads fields of many objects, with the calls in flight at once.
+
+                @param objects: Objects to read from
+                @type objects: iterable
+                @param fields: Fields to read, see L{get}
+                @param default: Value given for a field whose call failed, for
+                        instance because the object went away
+                @return: One tuple of values per object, in order
+                @rtype: list
+                """
+                batch = _Batch(self._context)
+                pending = self._submit(objects, fields, batch)
+                self._wait(batch)
+                return [tuple(default if future.exception() else future.result()
+                              for future in futures)
+                        for futures in pending]
+
+        async def fetchAsync(self, objects, *fields, default=None):
+                """
+                Coroutine version of L{fetch}, which does not block the asyncio event
+                loop while the replies arrive. The replies are dispatched from the
+                default GLib main context, so the asyncio loop must drive it: create
+                it with L{newEventLoop}, or run a GLib main loop.
+                """
+                import asyncio
+                pending = self._submit(objects, fields, self._defaultBatch())
+                flat = await asyncio.gather(*[asyncio.wrap_future(future)
+                                              for futures in pending
+                                              for future in futures],
+                                            return_exceptions=True)
+                width = len(fields)
+                return [tuple(default if isinstance(value, Exception) else value
+                              for value in flat[i:i + width])
+                        for i in range(0, len(flat), width)]
+
+        def close(self):
+                """
+                Closes the pipeline's connection to the accessibility bus.
+                """
+                connection, self._connection = self._connection, None
+                if connection:
+                        connection.close_sync(None)
+
+        def __enter__(self):
+                return self
+
+        def __exit__(self, *args):
+                self.close()
@@ -25,18 +25,341 @@
 __all__ = ["Registry",
            "MAIN_LOOP_GLIB",
            "MAIN_LOOP_NONE",
+           "MAIN_LOOP_PUMPED",
            "set_default_registry"]
 
 import os as _os
 from gi.repository import Atspi
 from gi.repository import GLib
+from pyatspi.appevent import EventType
+from pyatspi.cachebudget import CacheBudget
+from pyatspi.eventfilter import EventFilter
+from pyatspi.eventlog import EventRecorder
+from pyatspi.eventloop import EventStream
+from pyatspi.eventqueue import *
+from pyatspi.eventqueue import _Dispatcher
+from pyatspi.eventrouter import EventRouter
+from pyatspi.eventstats import EventStats
+from pyatspi.utils import _busName
+import collections
+import ctypes
+import ctypes.util
+import errno
+import fcntl
+import select
+import signal
+import threading
 import time
+import traceback
 
 #------------------------------------------------------------------------------
 
 MAIN_LOOP_GLIB = 'GLib'
 MAIN_LOOP_QT   = 'Qt'
 MAIN_LOOP_NONE = 'None'
+MAIN_LOOP_PUMPED = 'Pumped'
+
+# owner of the desktop, which has the applications as children
+_DESKTOP_BUS_NAME = 'org.a11y.atspi.Registry'
+
+#------------------------------------------------------------------------------
+
+class _Wakeup(object):
+        """
+        Self-pipe watched by the GLib main loop. Writing a byte to the pipe from
+        any thread (or from a signal handler through signal.set_wakeup_fd) makes
+        the main loop return from poll() and run the callback, so the loop can
+        block with the GIL released instead of polling.
+
+        @ivar fd: Write end of the pipe
+        @type fd: integer
+        @ivar read_fd: Read end of the pipe
+        @type read_fd: integer
+        """
+
+        def __init__(self, callback, interrupted):
+                self._callback = callback
+                self._interrupted = interrupted
+                self.read_fd, self.fd = _os.pipe()
+                for fd in (self.read_fd, self.fd):
+                        flags = fcntl.fcntl(fd, fcntl.F_GETFL)
+                        fcntl.fcntl(fd, fcntl.F_SETFL, flags | _os.O_NONBLOCK)
+                self._source = GLib.io_add_watch(self.read_fd,
+                                                 GLib.PRIORITY_DEFAULT,
+                                                 GLib.IOCondition.IN,
+                                                 self._on_readable)
+
+        def notify(self):
+                try:
+                        _os.write(self.fd, b'\0')
+                except OSError as e:
+                        # a full pipe already guarantees a pending wakeup
+                        if e.errno not in (errno.EAGAIN, errno.EWOULDBLOCK):
+                                raise
+
+        def _on_readable(self, fd, condition):
+                try:
+                        try:
+                                while _os.read(self.read_fd, 512):
+                                        pass
+                        except OSError as e:
+                                if e.errno not in (errno.EAGAIN, errno.EWOULDBLOCK):
+                                        raise
+                        self._callback()
+                except KeyboardInterrupt as e:
+                        # raised by the Python signal handler woken through the pipe
+                        self._interrupted(e)
+                return True
+
+        def close(self):
+                GLib.source_remove(self._source)
+                _os.close(self.read_fd)
+                _os.close(self.fd)
+
+#------------------------------------------------------------------------------
+
+class _PollerUnavailable(Exception):
+        pass
+
+class _GPollFD(ctypes.Structure):
+        _fields_ = [("fd", ctypes.c_int),
+                    ("events", ctypes.c_ushort),
+                    ("revents", ctypes.c_ushort)]
+
+class _ContextPoller(object):
+        """
+        Epoll set over the descriptors polled by the default GLib main context,
+        where libatspi reads the bus, see L{Registry.getPollFd}. It becomes
+        readable when one of them is; L{update} follows the descriptors GLib
+        adds and removes. Nothing runs in the background: the context is only
+        iterated by L{Registry.dispatchPending}, in the caller's thread.
+
+        g_main_context_query is called through ctypes, as its introspected
+        version does not return the descriptors. Where libglib cannot be loaded
+        that way or epoll is missing, L{_WakeupPoller} is used instead.
+
+        @ivar fd: Epoll descriptor
+        @type fd: integer
+        @ivar timeout: Milliseconds after which GLib wants the context iterated
+                even if no descriptor is readable, -1 for no limit
+        @type timeout: integer
+        """
+
+        _glib = None
+
+        def __init__(self):
+                """
+                @raise _PollerUnavailable: When epoll or libglib cannot be used
+                """
+                self._library()
+                if not hasattr(select, 'epoll'):
+                        raise _PollerUnavailable("epoll is not available")
+                self._epoll = select.epoll()
+                self.fd = self._epoll.fileno()
+                self.timeout = -1
+                self._fds = {}
+                try:
+                        self.update()
+                except Exception:
+                        self._epoll.close()
+                        raise
+
+        @classmethod
+        def _library(cls):
+                glib = cls._glib
+                if glib is None:
+                        name = ctypes.util.find_library("glib-2.0") or "libglib-2.0.so.0"
+                        try:
+                                glib = ctypes.CDLL(name)
+                                glib.g_main_context_query
+                        except (OSError, AttributeError) as e:
+                                raise _PollerUnavailable("cannot load libglib: %s" % e)
+                        glib.g_main_context_default.restype = ctypes.c_void_p
+                        glib.g_main_context_default.argtypes = []
+                        glib.g_main_context_acquire.argtypes = [ctypes.c_void_p]
+                        glib.g_main_context_release.argtypes = [ctypes.c_void_p]
+                        glib.g_main_context_prepare.argtypes = [ctypes.c_void_p,
+                                                                ctypes.POINTER(ctypes.c_int)]
+                        glib.g_main_context_query.argtypes = [ctypes.c_void_p, ctypes.c_int,
+                                                              ctypes.POINTER(ctypes.c_int),
+                                                              ctypes.POINTER(_GPollFD),
+                                                              ctypes.c_int]
+                        cls._glib = glib
+                return glib
+
+        def update(self):
+                """
+                Reads the descriptors and timeout GLib would poll for now.
+
+                @raise RuntimeError: When another thread runs the main context
+                """
+                glib = self._library()
+                context = glib.g_main_context_default()
+                if not context:
+                        raise RuntimeError("no default GLib main context")
+                if not glib.g_main_context_acquire(context):
+                        raise RuntimeError("the GLib main context is run by another thread")
+                try:
+                        priority = ctypes.c_int()
+                        ready = glib.g_main_context_prepare(context, ctypes.byref(priority))
+                        size = 8
+                        while True:
+                                fds = (_GPollFD * size)()
+                                timeout = ctypes.c_int()
+                                count = glib.g_main_context_query(context, priority.value,
+                                                                  ctypes.byref(timeout),
+                                                                  fds, size)
+                                if count < 0:
+                                        raise RuntimeError("g_main_context_query failed")
+                                if count <= size:
+                                        break
+                                size = count
+                finally:
+                        glib.g_main_context_release(context)
+                wanted = {}
+                for pollfd in fds[:count]:
+                        wanted[pollfd.fd] = wanted.get(pollfd.fd, 0) | pollfd.events
+                for fd in self._fds:
+                        if fd not in wanted:
+                                try:
+                                        self._epoll.unregister(fd)
+                                except OSError:
+                                        # closed, which already removed it
+                                        pass
+                for fd, events in wanted.items():
+                        # GLib and epoll share the poll(2) event bits
+                        if fd not in self._fds:
+                                self._epoll.register(fd, events)
+                        elif self._fds[fd] != events:
+                                self._epoll.modify(fd, events)
+                self._fds = wanted
+                self.timeout = 0 if ready else timeout.value
+
+        def close(self):
+                self._epoll.close()
+
+class _WakeupPoller(object):
+        """
+        Stand-in for L{_ContextPoller} where it is unavailable. The descriptor is
+        the read end of a L{_Wakeup} pipe, which only becomes readable for calls
+        queued by L{Registry.callFromThread}; bus traffic is found by dispatching
+        at least every INTERVAL milliseconds, as given by the timeout.
+        """
+
+        INTERVAL = 10
+
+        def __init__(self, registry):
+                self.wakeup = _Wakeup(registry._runPendingCalls, registry._interrupt)
+                self.fd = self.wakeup.read_fd
+                self.timeout = self.INTERVAL
+
+        def update(self):
+                if GLib.MainContext.default().pending():
+                        self.timeout = 0
+                else:
+                        self.timeout = self.INTERVAL
+
+        def close(self):
+                self.wakeup.close()
+
+#------------------------------------------------------------------------------
+
+class _Coalescer(object):
+        """
+        Merges the events sent to one client within time windows set per full or
+        partial event name; events of other types are not held back. Events with
+        the same type and source replace each other, and when the window expires
+        the client receives the latest of each with a 'coalesced' attribute
+        holding the number of events it stands for. object:children-changed
+        events only replace those about the same child (any_data), so that no
+        added or removed child is lost. Keys are delivered in the order they were
+        first seen.
+        """
+
+        def __init__(self, deliver):
+                self._deliver = deliver
+                # canonical event name -> window in seconds
+                self._windows = {}
+                # event type -> window, or None when not coalesced
+                self._lookup = {}
+                # window -> OrderedDict of key -> (event, count)
+                self._pending = {}
+                # window -> timeout source
+                self._timers = {}
+                self._lock = threading.Lock()
+
+        def __bool__(self):
+                return bool(self._windows)
+
+        def setWindow(self, name, window):
+                with self._lock:
+                        if window:
+                                self._windows[name] = window
+                        else:
+                                self._windows.pop(name, None)
+                        self._lookup = {}
+
+        def _window(self, event_type):
+                try:
+                        return self._lookup[event_type]
+                except KeyError:
+                        pass
+                window = None
+                parts = [p for p in (event_type.klass, event_type.major,
+                                     event_type.minor, event_type.detail) if p]
+                for i in range(len(parts), 0, -1):
+                        window = self._windows.get(EventType._SEPARATOR.join(parts[:i]))
+                        if window is not None:
+                                break
+                self._lookup[event_type] = window
+                return window
+
+        def add(self, event):
+                """
+                @return: Was the event held back for merging?
+                @rtype: boolean
+                """
+                event_type = event.type
+                with self._lock:
+                        window = self._window(event_type)
+                        if window is None:
+                                return False
+                        if event_type.major == 'children-changed':
+                                key = (event_type, event.source, event.any_data)
+                        else:
+                                key = (event_type, event.source)
+                        try:
+                                pending = self._pending[window]
+                        except KeyError:
+                                pending = self._pending[window] = collections.OrderedDict()
+                        try:
+                                count = pending[key][1]
+                        except KeyError:
+                                count = 0
+                        except TypeError:
+                                # any_data of an unhashable kind, not merged
+                                return False
+                        pending[key] = (event, count + 1)
+                        if window not in self._timers:
+                                self._timers[window] = GLib.timeout_add(int(window * 1000),
+                                                                        self._flush, window)
+                        return True
+
+        def _flush(self, window):
+                with self._lock:
+                        pending = self._pending.pop(window, {})
+                        self._timers.pop(window, None)
+                for event, count in pending.values():
+                        event.coalesced = count
+                        self._deliver(event)
+                return False
+
+        def cancel(self):
+                with self._lock:
+                        for timer in self._timers.values():
+                                GLib.source_remove(timer)
+                        self._timers.clear()
+                        self._pending.clear()
 
 #------------------------------------------------------------------------------
 
@@ -50,17 +373,17 @@ class Registry(object):
         reference to the Accessibility.Registry singleton. Doing so is harmless and
         has no point.
 
-        @@ivar asynchronous: Should event dispatch to local listeners be decoupled
+        @ivar asynchronous: Should event dispatch to local listeners be decoupled
                 from event receiving from the registry?
-        @@type asynchronous: boolean
-        @@ivar reg: Reference to the real, wrapped registry object
-        @@type reg: Accessibility.Registry
-        @@ivar dev: Reference to the device controller
-        @@type dev: Accessibility.DeviceEventController
-        @@ivar clients: Map of event names to client listeners
-        @@type clients: dictionary
-        @@ivar observers: Map of event names to AT-SPI L{_Observer} objects
-        @@type observers: dictionary
+        @type asynchronous: boolean
+        @ivar reg: Reference to the real, wrapped registry object
+        @type reg: Accessibility.Registry
+        @ivar dev: Reference to the device controller
+        @type dev: Accessibility.DeviceEventController
+        @ivar event_listeners: Map of keystroke clients to AT-SPI device listeners
+        @type event_listeners: dictionary
+        @ivar router: Map of event names to client listeners
+        @type router: L{EventRouter}
         """
         __shared_state = {}
 
@@ -81,6 +404,17 @@ class Registry(object):
 
                 self.main_loop = GLib.MainLoop()
 
+                self._pending_calls = collections.deque()
+                self._wakeup = None
+                self._keyboard_exception = None
+                self._poller = None
+                # kept across _set_registry, which may run lazily after these
+                # were set
+                self._stats = None
+                self._recorder = None
+                self._dropped = 0
+                self._cache_budget = None
+
         def __call__(self):
                 """
                 @@return: This instance of the registry
@@ -99,7 +433,7 @@ class Registry(object):
                 This function should be called before pyatspi is used if you
                 wish to change these defaults.
 
-                @@param main_loop_type: 'GLib', 'None' or 'Qt'. If 'None' is selected then caching
+                @@param main_loop_type: 'GLib', 'None', 'Pumped' or 'Qt'. If 'None' is selected then caching
                                        is disabled.
 
                 @@param use_registry: Whether to connect to a registry daemon for device events.
@@ -107,13 +441,34 @@ class Registry(object):
                                      app_name parameter.
 
                 @@param app_name: D-Bus name of the application to connect to when not using the registry daemon.
+
+                With 'Pumped' (MAIN_LOOP_PUMPED), received events are kept in a
+                bounded queue until the application calls L{pumpQueuedEvents}.
                 """
 
                 self.has_implementations = True
+                self.main_loop_type = main_loop_type
 
-                self.asynchronous = False	# not fully supported yet
+                self.asynchronous = False
                 self.started = False
                 self.event_listeners = dict()
+                # keystroke client -> {(mask, key set, kind): sync flags}
+                self._keystroke_registrations = dict()
+                self.router = EventRouter()
+                self._coalescers = dict()
+                self._filters = dict()
+                self._client_priorities = dict()
+                # event type -> priority, see _itemPriority
+                self._priorities = dict()
+                # single native listener shared by all event names
+                self._listener = Atspi.EventListener.new(self._receiveEvent)
+                self._queue = None
+                self._dispatcher = None
+                self._drain_source = None
+                # events delivered from the bus, counted for pumpQueuedEvents
+                self._delivered = 0
+                if main_loop_type == MAIN_LOOP_PUMPED:
+                        self._queue = EventQueue(priority=self._itemPriority)
 
         def __getattr__(self, name):
             """
@@ -134,26 +489,106 @@ class Registry(object):
         def _set_default_registry (self):
                 self._set_registry (MAIN_LOOP_GLIB)
 
-        def start(self, asynchronous=False, gil=True, **kwargs):
+        def start(self, asynchronous=False, gil=True, wakeup=False, queued=False,
+                  queue_size=1024, overflow=QUEUE_DROP_OLDEST, workers=1,
+                  schedule=SCHEDULE_FIFO, weights=None, **kwargs):
                 """
                 Enter the main loop to start receiving and dispatching events.
 
                 @@param asynchronous: Should event dispatch be asynchronous
                         (decoupled) from event receiving from the AT-SPI registry?
+                        When True, the main loop only queues incoming events and
+                        worker threads call the listeners registered with
+                        L{registerEventListener}. Keystroke listeners are always
+                        called synchronously since they may consume the event.
+                        libatspi is not thread-safe and keeps running the main loop
+                        meanwhile, so listeners must only use the data carried by the
+                        event (type, details, any_data) and pure Python code. Anything
+                        reaching an accessible, including event.source, has to be
+                        handed back to the main loop with L{callFromThread}.
                 @@type asynchronous: boolean
                 @@param gil: Add an idle callback which releases the Python GIL for a few
                         milliseconds to allow other threads to run? Necessary if other threads
-                        will be used in this process.
+                        will be used in this process. Ignored when wakeup is True.
                 @@type gil: boolean
+                @@param wakeup: Block in the main loop with the GIL released and let
+                        other threads wake it through L{callFromThread} instead of
+                        polling from an idle callback. Idle CPU use is nil and
+                        cross-thread calls run as soon as they are queued.
+                @@type wakeup: boolean
+                @@param queued: Buffer received events in a bounded queue even when
+                        dispatching synchronously. The main loop keeps reading events
+                        from the bus and dispatches a batch of them on each iteration,
+                        so that a backlog is bounded by queue_size instead of piling up
+                        in the D-Bus connection. Events still queued when the main loop
+                        stops are discarded and counted by L{getDroppedCount}. Implied
+                        by asynchronous.
+                @@type queued: boolean
+                @@param queue_size: Maximum number of events waiting for dispatch
+                @@type queue_size: integer
+                @@param overflow: What to do with events received while the queue is
+                        full: QUEUE_DROP_OLDEST, QUEUE_DROP_NEWEST or
+                        QUEUE_DROP_BY_PRIORITY (see L{setEventPriority}). Drop counters
+                        are available from L{getQueueStats}. QUEUE_BLOCK is refused: it
+                        would stall the main loop, which listeners may be waiting for.
+                @@type overflow: string
+                @@param workers: Number of dispatch threads in asynchronous mode. Events
+                        are only delivered in order with a single worker. The
+                        restrictions of asynchronous apply to every worker.
+                @@type workers: integer
+                @@param schedule: Order in which queued events are dispatched:
+                        SCHEDULE_FIFO (arrival order), SCHEDULE_STRICT (higher priority
+                        events first) or SCHEDULE_WEIGHTED (priority lanes share
+                        dispatch according to weights). Priorities come from
+                        L{setEventPriority} and from the priority given to
+                        L{registerEventListener}.
+                @@type schedule: string
+                @@param weights: Map of priorities to weights for SCHEDULE_WEIGHTED
+                @@type weights: dictionary
+                @@raise ValueError: When overflow is QUEUE_BLOCK
                 """
                 if 'async' in kwargs:
                     # support previous API
                     asynchronous = kwargs['async']
                 if not self.has_implementations:
                         self._set_default_registry ()
+                if overflow == QUEUE_BLOCK:
+                        # the queue is filled from the main loop: blocking there
+                        # would stop reception, and any worker waiting for a reply
+                        # the main loop has to read would never be released
+                        raise ValueError("QUEUE_BLOCK cannot be used while the main loop runs")
+                if self._poller is not None:
+                        raise RuntimeError("events are received for getPollFd(), "
+                                           "call closePollFd() first")
                 self.started = True
 
-                if gil:
+                pumped_queue = self._queue
+                if asynchronous or queued:
+                        self._queue = EventQueue(queue_size, overflow, self._itemPriority,
+                                                 schedule, weights)
+                if asynchronous:
+                        self._dispatcher = _Dispatcher(self._queue, self._dispatchEvent, workers)
+                        self.asynchronous = True
+                try:
+                        self._runMainLoop(gil, wakeup)
+                finally:
+                        if self._dispatcher is not None:
+                                self._dispatcher.stop()
+                                self._dispatcher = None
+                                self.asynchronous = False
+                        if self._drain_source is not None:
+                                GLib.source_remove(self._drain_source)
+                                self._drain_source = None
+                        queue, self._queue = self._queue, pumped_queue
+                        if queue is not pumped_queue:
+                                # nothing dispatches them once the loop is gone
+                                self._dropped += queue.discard()
+                        self.started = False
+
+        def _runMainLoop(self, gil, wakeup):
+                if wakeup:
+                        self._runWakeupLoop()
+                elif gil:
                         def releaseGIL():
                                 try:
                                         time.sleep(1e-2)
@@ -173,7 +608,72 @@ class Registry(object):
                 else:
                         Atspi.event_main()
 
-                self.started = False
+        def _runWakeupLoop(self):
+                """
+                Runs the main loop with a L{_Wakeup} pipe attached. When called from
+                the main thread the pipe also receives signals, so that a
+                KeyboardInterrupt still stops the loop while it sleeps in poll().
+                """
+                self._keyboard_exception = None
+                wakeup = _Wakeup(self._runPendingCalls, self._interrupt)
+                old_fd = None
+                if threading.current_thread() is threading.main_thread():
+                        old_fd = signal.set_wakeup_fd(wakeup.fd)
+                self._wakeup = wakeup
+                # calls queued before the pipe existed were not notified
+                if self._pending_calls:
+                        wakeup.notify()
+                try:
+                        Atspi.event_main()
+                finally:
+                        self._wakeup = None
+                        if old_fd is not None:
+                                signal.set_wakeup_fd(old_fd)
+                        wakeup.close()
+                if self._keyboard_exception is not None:
+                        e, self._keyboard_exception = self._keyboard_exception, None
+                        raise e
+
+        def _runPendingCalls(self):
+                """
+                Runs the calls queued by L{callFromThread} on the main loop.
+                """
+                try:
+                        while True:
+                                try:
+                                        func, args = self._pending_calls.popleft()
+                                except IndexError:
+                                        break
+                                try:
+                                        func(*args)
+                                except Exception:
+                                        traceback.print_exc()
+                except KeyboardInterrupt as e:
+                        self._interrupt(e)
+                return False
+
+        def _interrupt(self, e):
+                # store the exception for later
+                self._keyboard_exception = e
+                self.stop()
+
+        def callFromThread(self, func, *args):
+                """
+                Schedules a call to be made from the thread running the main loop.
+                Safe to call from any thread. When the registry was started with
+                wakeup=True the main loop is woken through its wakeup pipe,
+                otherwise the call is dispatched from a GLib idle callback.
+
+                @@param func: Callable to invoke on the main loop
+                @@type func: callable
+                @@param args: Positional arguments passed to func
+                """
+                self._pending_calls.append((func, args))
+                wakeup = self._wakeup
+                if wakeup is not None:
+                        wakeup.notify()
+                else:
+                        GLib.idle_add(self._runPendingCalls)
 
         def stop(self, *args):
                 """
@@ -208,7 +708,283 @@ class Registry(object):
         def eventWrapper(self, event, callback):
                 return callback(event)
 
-        def registerEventListener(self, client, *names):
+        def _receiveEvent(self, event):
+                """
+                Called from the main loop for every event received. Logs the event
+                when recording, then delivers it.
+                """
+                recorder = self._recorder
+                if recorder is not None:
+                        recorder.record(event)
+                self._deliverEvent(event)
+
+        def _deliverEvent(self, event):
+                """
+                Hands an event to the dispatch queue in asynchronous mode, dispatches
+                it otherwise. Replayed events come in here, past the recorder, so that
+                replaying while recording does not log them again.
+                """
+                self._delivered += 1
+                budget = self._cache_budget
+                if budget is not None:
+                        self._trackSource(budget, event)
+                stats = self._stats
+                if stats is not None:
+                        stats.recordArrival(event.type)
+                queue = self._queue
+                if queue is not None:
+                        self._enqueue(queue, (event,))
+                else:
+                        self._dispatchEvent(event)
+
+        def _trackSource(self, budget, event):
+                event_type = event.type
+                if (event_type.major == 'state-changed' and event_type.minor == 'focused'
+                    and event.detail1) or \
+                   (event_type.klass == 'window' and event_type.major == 'activate'):
+                        budget.focus(event.source)
+                else:
+                        budget.touch(event.source)
+
+        def setCacheBudget(self, max_objects):
+                """
+                Bounds the number of accessibles whose libatspi cached data is kept
+                per application, clearing that of the least recently used ones.
+                Event sources count as used; the focused object and its ancestors
+                are never evicted. See L{CacheBudget} for what this does and does
+                not free.
+
+                @@param max_objects: Maximum number of cached accessibles per
+                        application, or None to stop evicting
+                @@type max_objects: integer
+                """
+                if max_objects is None:
+                        if self._cache_budget is not None:
+                                self._cache_budget = None
+                                self.deregisterEventListener(self._forgetApplication,
+                                                             'object:children-changed:remove')
+                        return
+                if self._cache_budget is None:
+                        # the desktop announces applications leaving with this event
+                        self.registerEventListener(self._forgetApplication,
+                                                   'object:children-changed:remove',
+                                                   filter=EventFilter(applications=_DESKTOP_BUS_NAME))
+                self._cache_budget = CacheBudget(max_objects)
+
+        def _forgetApplication(self, event):
+                budget = self._cache_budget
+                if budget is not None:
+                        bus_name = _busName(event.any_data)
+                        if bus_name is not None:
+                                budget.forget(bus_name)
+
+        def getCacheBudget(self):
+                """
+                @@return: The budget set with L{setCacheBudget}, or None
+                @@rtype: L{CacheBudget}
+                """
+                return self._cache_budget
+
+        def _enqueue(self, queue, item):
+                self._put(queue, item)
+                if self._dispatcher is not None:
+                        return
+                if not self.started:
+                        # left for pumpQueuedEvents
+                        return
+                if self._drain_source is None:
+                        # same priority as reception, which would starve an idle
+                        # priority source during an event storm
+                        self._drain_source = GLib.idle_add(self._drainQueue,
+                                                           priority=GLib.PRIORITY_DEFAULT)
+
+        def _put(self, queue, item):
+                # only called from the reception thread, the one changing dropped
+                dropped = queue.dropped
+                queue.put(item)
+                if queue.dropped != dropped:
+                        self._dropped += queue.dropped - dropped
+
+        # events dispatched by _drainQueue per main loop iteration
+        _DRAIN_BATCH = 64
+
+        def _drainQueue(self):
+                """
+                Callback dispatching queued events in synchronous mode. Returns to the
+                main loop after a batch so that reception is not starved either.
+                """
+                queue = self._queue
+                for i in range(self._DRAIN_BATCH):
+                        try:
+                                item = queue.get(False)
+                        except IndexError:
+                                self._drain_source = None
+                                return False
+                        self._dispatchEvent(*item)
+                return True
+
+        def getQueueStats(self):
+                """
+                Gets the state of the event queue enabled by the queued or asynchronous
+                arguments of L{start}: length, capacity, high water mark, and the
+                number of events dropped by the overflow policy, in total and per event
+                type.
+
+                @@return: Queue statistics, or None when events are not queued
+                @@rtype: dictionary
+                """
+                if not self.has_implementations:
+                        return None
+                queue = self._queue
+                if queue is None:
+                        return None
+                return queue.getStats()
+
+        def getDroppedCount(self):
+                """
+                Gets the number of events discarded by the overflow policy of the
+                event queue, or left in it when the main loop stopped, since the
+                registry was created. Listeners keeping state built from events, like
+                L{TreeMirror}, compare it between events to find out that they missed
+                some and must resynchronize.
+
+                @@return: Number of events dropped
+                @@rtype: integer
+                """
+                return self._dropped
+
+        def _dispatchEvent(self, event, client=None):
+                """
+                Calls every client whose registration matches the event type, or
+                only the given client for events released by its L{_Coalescer}.
+                """
+                if client is not None:
+                        clients = (client,)
+                else:
+                        clients = self.router.route(event.type)
+                        coalescers = self._coalescers
+                        filters = self._filters
+                stats = self._stats
+                for client_ in clients:
+                        if client is None:
+                                if filters:
+                                        event_filter = filters.get(client_)
+                                        if event_filter is not None and not event_filter.match(event):
+                                                continue
+                                coalescer = coalescers.get(client_)
+                                if coalescer is not None and coalescer.add(event):
+                                        continue
+                        if stats is not None:
+                                start = time.perf_counter()
+                        try:
+                                self.eventWrapper(event, client_)
+                        except Exception:
+                                traceback.print_exc()
+                        if stats is not None:
+                                stats.recordCall(client_, time.perf_counter() - start)
+
+        def startRecording(self, fp):
+                """
+                Writes every event received from now on to a compact binary log:
+                type, details, a summary of any_data, the source bus name and path, and
+                the reception time. Use L{EventReplayer} to feed a log back to
+                registered listeners without any running application.
+
+                @@param fp: File name, or binary file object open for writing
+                @@type fp: string or file
+                @@return: The recorder, whose count attribute is the number of events
+                        recorded so far
+                @@rtype: L{EventRecorder}
+                """
+                self.stopRecording()
+                self._recorder = EventRecorder(fp)
+                return self._recorder
+
+        def stopRecording(self):
+                """
+                Stops recording started by L{startRecording} and flushes the log.
+                """
+                recorder, self._recorder = self._recorder, None
+                if recorder is not None:
+                        recorder.close()
+
+        def setStatsEnabled(self, enabled=True):
+                """
+                Starts or stops gathering dispatch statistics. Enabling always starts
+                from fresh counters.
+
+                @@param enabled: Record statistics?
+                @@type enabled: boolean
+                """
+                if enabled:
+                        self._stats = EventStats()
+                else:
+                        self._stats = None
+
+        def getStats(self):
+                """
+                Gets the dispatch statistics: for each listener registered with
+                L{registerEventListener}, its number of calls, cumulative time and a
+                latency histogram, and for each event type, how many events arrived and
+                at which rate. Use toDict() or dump() on the result to get them as plain
+                data or JSON.
+
+                @@return: Statistics, or None when not enabled with L{setStatsEnabled}
+                @@rtype: L{EventStats}
+                """
+                return self._stats
+
+        def _itemPriority(self, item):
+                """
+                Gets the priority of a queued item: the priority of its event type,
+                raised to the highest priority given to a listener it goes to.
+                """
+                event_type = item[0].type
+                if len(item) > 1:
+                        priority = eventPriority(event_type)
+                        client_priority = self._client_priorities.get(item[1])
+                        if client_priority is not None and client_priority > priority:
+                                priority = client_priority
+                        return priority
+                try:
+                        return self._priorities[event_type]
+                except KeyError:
+                        pass
+                priority = eventPriority(event_type)
+                if self._client_priorities:
+                        for client in self.router.route(event_type):
+                                client_priority = self._client_priorities.get(client)
+                                if client_priority is not None and client_priority > priority:
+                                        priority = client_priority
+                if len(self._priorities) >= 1024:
+                        self._priorities.clear()
+                self._priorities[event_type] = priority
+                return priority
+
+        def _releaseCoalesced(self, client, event):
+                queue = self._queue
+                if queue is not None:
+                        self._enqueue(queue, (event, client))
+                else:
+                        self._dispatchEvent(event, client)
+
+        def _setCoalesce(self, client, names, coalesce):
+                if isinstance(coalesce, dict):
+                        windows = coalesce.items()
+                else:
+                        windows = [(name, coalesce) for name in names]
+                coalescer = self._coalescers.get(client)
+                if coalescer is None:
+                        coalescer = _Coalescer(lambda event: self._releaseCoalesced(client, event))
+                for name, window in windows:
+                        coalescer.setWindow(EventRouter.canonical(name), window)
+                if coalescer:
+                        self._coalescers[client] = coalescer
+                elif self._coalescers.pop(client, None) is not None:
+                        coalescer.cancel()
+
+        def registerEventListener(self, client, *names, coalesce=None, priority=None,
+                                  filter=None):
                 """
                 Registers a new client callback for the given event names. Supports 
                 registration for all subevents if only partial event name is specified.
@@ -223,19 +999,78 @@ class Registry(object):
                 To ensure the client is properly garbage collected, call 
                 L{deregisterEventListener}.
 
+                Clients share a single AT-SPI listener: only the first registration of
+                a given name subscribes to it on the bus, and received events are
+                routed to clients locally.
+
                 @@param client: Callable to be invoked when the event occurs
                 @@type client: callable
                 @@param names: List of full or partial event names
                 @@type names: list of string
+                @@param coalesce: Window in seconds during which events of the same type
+                        from the same source are merged before reaching the client. At
+                        the end of the window the client receives the latest of them,
+                        with a 'coalesced' attribute counting the merged events.
+                        object:children-changed events are only merged when they are
+                        about the same child. A number applies to the names given in
+                        this call; a dictionary maps full or partial event names to
+                        windows, e.g. {'object:bounds-changed': 0.1}, so that a client
+                        can merge bulk updates while still getting focus changes at
+                        once. Events of other types are not delayed. None leaves the
+                        current settings unchanged and a window of 0 stops merging.
+                @@type coalesce: float or dictionary
+                @@param priority: PRIORITY_LOW, PRIORITY_NORMAL or PRIORITY_HIGH. Queued
+                        events going to this client are dispatched at least at this
+                        priority when the registry is started with a SCHEDULE_STRICT or
+                        SCHEDULE_WEIGHTED schedule. None leaves the current setting
+                        unchanged.
+                @@type priority: integer
+                @@param filter: Conditions on the application, source role and detail
+                        values of the events passed to this client, checked before the
+                        client is called. Applies to all names the client is registered
+                        for; None leaves the current filter unchanged and an empty
+                        EventFilter() removes it.
+                @@type filter: L{EventFilter}
                 """
                 if not self.has_implementations:
                         self._set_default_registry ()
-                try:
-                        listener = self.event_listeners[client]
-                except:
-                        listener = self.event_listeners[client] = Atspi.EventListener.new(self.eventWrapper, client)
+                if filter is not None:
+                        if filter:
+                                self._filters[client] = filter
+                        else:
+                                self._filters.pop(client, None)
+                if priority is not None:
+                        self._client_priorities[client] = priority
+                self._priorities.clear()
+                if coalesce is not None:
+                        self._setCoalesce(client, names, coalesce)
                 for name in names:
-                        Atspi.EventListener.register (listener, name)
+                        if self.router.add(client, name):
+                                Atspi.EventListener.register(self._listener,
+                                                             EventRouter.canonical(name))
+
+        def events(self, *names, maxsize=0):
+                """
+                Gets an asynchronous iterator over the events received for the given
+                full or partial event names, for use from asyncio code:
+
+                async for event in pyatspi.Registry.events('object:state-changed'):
+                        ...
+
+                Without a running GLib main loop, the asyncio loop must drive the AT-SPI
+                connection: create it with L{newEventLoop} or install
+                L{GLibEventLoopPolicy}. Close the stream, or use it with async with, to
+                deregister it.
+
+                @@param names: List of full or partial event names
+                @@type names: list of string
+                @@param maxsize: Number of events buffered before the oldest are
+                        dropped, 0 for no limit
+                @@type maxsize: integer
+                @@rtype: L{EventStream}
+                @@raise RuntimeError: When called outside of a running asyncio loop
+                """
+                return EventStream(self, names, maxsize)
 
         def deregisterEventListener(self, client, *names):
                 """
@@ -256,12 +1091,19 @@ class Registry(object):
                 """
                 if not self.has_implementations:
                         self._set_default_registry ()
-                try:
-                        listener = self.event_listeners[client]
-                except:
-                        return
+                missing = False
                 for name in names:
-                        Atspi.EventListener.deregister(listener, name)
+                        registered, released = self.router.remove(client, name)
+                        missing = missing or not registered
+                        for released_name in released:
+                                Atspi.EventListener.deregister(self._listener, released_name)
+                if client not in self.router:
+                        if client in self._coalescers:
+                                self._coalescers.pop(client).cancel()
+                        self._filters.pop(client, None)
+                        self._client_priorities.pop(client, None)
+                self._priorities.clear()
+                return missing
 
         # -------------------------------------------------------------------------------
 
@@ -294,7 +1136,9 @@ class Registry(object):
                                       preemptive=True,
                                       global_=False):
                 """
-                Registers a listener for key stroke events.
+                Registers a listener for key stroke events. Registering a client again
+                for the same key set, mask and kind replaces the previous registration,
+                for instance to change its synchronous, preemptive or global_ flags.
 
                 @@param client: Callable to be invoked when the event occurs
                 @@type client: callable
@@ -328,16 +1172,32 @@ class Registry(object):
                 except:
                         listener = self.event_listeners[client] = Atspi.DeviceListener.new(self.eventWrapper, client)
                 syncFlag = self.makeSyncType(synchronous, preemptive, global_)
-                if hasattr(mask, '__iter__'):
-                        masks = mask
-                else:
-                        masks = [mask]
-                for m in masks:
+                kindMask = self.makeKind(kind)
+                keys = tuple(key_set)
+                registered = self._keystroke_registrations.setdefault(client, {})
+                for m in self._uniqueMasks(mask):
+                        # each mask costs a round trip to the device event controller,
+                        # so do not repeat registrations that are already in place
+                        key = (m, keys, kindMask)
+                        old = registered.get(key)
+                        if old == syncFlag:
+                                continue
+                        if old is not None:
+                                # new flags replace the old registration instead of
+                                # adding a second one next to it
+                                Atspi.deregister_keystroke_listener(listener, key_set,
+                                                                    m, kindMask)
                         Atspi.register_keystroke_listener(listener,
                                                           key_set,
                                                           m,
-                                                          self.makeKind (kind),
+                                                          kindMask,
                                                           syncFlag)
+                        registered[key] = syncFlag
+
+        def _uniqueMasks(self, mask):
+                if hasattr(mask, '__iter__'):
+                        return collections.OrderedDict.fromkeys(mask).keys()
+                return [mask]
 
         def deregisterKeystrokeListener(self,
                                         client,
@@ -371,16 +1231,48 @@ class Registry(object):
                 except:
                         return
 
-                if hasattr(mask, '__iter__'):
-                        masks = mask
-                else:
-                        masks = [mask]
-                for m in masks:
+                kindMask = self.makeKind(kind)
+                keys = tuple(key_set)
+                registered = self._keystroke_registrations.get(client, {})
+                for m in self._uniqueMasks(mask):
                         Atspi.deregister_keystroke_listener (listener, key_set,
-                                m, self.makeKind(kind))
+                                m, kindMask)
+                        registered.pop((m, keys, kindMask), None)
+                if not registered:
+                        self._forgetKeystrokeClient(client)
 
                 # TODO: enqueueEvent, etc?
 
+        def deregisterKeystrokeListeners(self, client):
+                """
+                Deregisters every key set, mask and kind of event a client was registered
+                for with L{registerKeystrokeListener}, for instance after registering
+                with mask=L{allModifiers}(), without having to repeat the registration
+                arguments.
+
+                @@param client: Client callback to remove
+                @@type client: callable
+                @@return: Number of registrations removed
+                @@rtype: integer
+                """
+                if not self.has_implementations:
+                        self._set_default_registry ()
+                try:
+                        listener = self.event_listeners[client]
+                except KeyError:
+                        return 0
+                registered = self._keystroke_registrations.get(client, {})
+                for m, keys, kindMask in registered:
+                        Atspi.deregister_keystroke_listener(listener, list(keys), m, kindMask)
+                count = len(registered)
+                self._forgetKeystrokeClient(client)
+                return count
+
+        def _forgetKeystrokeClient(self, client):
+                # drop the device listener so that the client can be garbage collected
+                self._keystroke_registrations.pop(client, None)
+                self.event_listeners.pop(client, None)
+
         def generateKeyboardEvent(self, keycode, keysym, kind):
                 """
                 Generates a keyboard event. One of the keycode or the keysym parameters
@@ -437,11 +1329,162 @@ class Registry(object):
                         self._set_default_registry ()
                 Atspi.setReferenceWindow(accessible)
 
-        def pumpQueuedEvents (self):
+        def pumpQueuedEvents (self, count=None, timeout=None):
+                """
+                Dispatch events that have been queued. Meant for applications that
+                interleave accessibility processing with their own loop instead of
+                calling L{start}.
+
+                With MAIN_LOOP_PUMPED (see L{set_default_registry}), pending messages
+                are first read from the bus without blocking, then queued events are
+                dispatched until the budget is exhausted.
+
+                With MAIN_LOOP_NONE, or MAIN_LOOP_GLIB while L{start} is not running,
+                events are not queued: the default GLib main context is iterated
+                without blocking, dispatching events as they are read, until nothing
+                is pending or the budget is exhausted. An
+                iteration may dispatch more than one event, so count can be
+                exceeded by the events read together.
+
+                @@param count: Maximum number of events to dispatch, None for no limit
+                @@type count: integer
+                @@param timeout: Maximum time to spend, in seconds, None for no limit
+                @@type timeout: float
+                @@return: With a queue, the number of events still queued. Without
+                        one, the number of events dispatched.
+                @@rtype: integer
+                """
+                if not self.has_implementations:
+                        self._set_default_registry ()
+                deadline = None
+                if timeout is not None:
+                        deadline = time.perf_counter() + timeout
+                queue = self._queue
+                if queue is None:
+                        return self._pumpContext(count, deadline)
+                if not self.started:
+                        context = GLib.MainContext.default()
+                        # bounded so that an event storm cannot keep us reading forever
+                        for i in range(queue.maxsize):
+                                if not context.pending():
+                                        break
+                                context.iteration(False)
+                                if deadline is not None and time.perf_counter() >= deadline:
+                                        break
+                dispatched = 0
+                while count is None or dispatched < count:
+                        if deadline is not None and time.perf_counter() >= deadline:
+                                break
+                        try:
+                                item = queue.get(False)
+                        except IndexError:
+                                break
+                        self._dispatchEvent(*item)
+                        dispatched += 1
+                return len(queue)
+
+        def _pumpContext(self, count, deadline):
+                """
+                Iterates the default main context for L{pumpQueuedEvents} when events
+                are dispatched as they are read.
+
+                @return: Number of events dispatched
+                """
+                if self.started:
+                        # the main loop already dispatches them
+                        return 0
+                context = GLib.MainContext.default()
+                first = self._delivered
+                while context.pending():
+                        if count is not None and self._delivered - first >= count:
+                                break
+                        if deadline is not None and time.perf_counter() >= deadline:
+                                break
+                        context.iteration(False)
+                return self._delivered - first
+
+        def getPollFd(self):
+                """
+                Gets a file descriptor which becomes readable when the AT-SPI
+                connection needs attention, for applications running their own
+                select, poll or epoll loop instead of L{start}. Nothing runs in the
+                background: when the descriptor is readable, or after the delay
+                given by L{getPollTimeout}, call L{dispatchPending}, which reads the
+                bus and calls listeners in the caller's thread. Events are queued as
+                with MAIN_LOOP_PUMPED (see L{set_default_registry}) in between.
+
+                The default GLib main context must not be run by another thread. The
+                descriptor stays valid until L{closePollFd}.
+
+                The descriptor follows the bus through epoll and libglib loaded with
+                ctypes. Where either is missing, it only wakes up for
+                L{callFromThread}, and L{getPollTimeout} asks for a dispatch every
+                few milliseconds instead.
+
+                @@return: File descriptor to watch for reading
+                @@rtype: integer
+                @@raise RuntimeError: When the main loop is running
+                """
+                if not self.has_implementations:
+                        self._set_default_registry ()
+                if self._poller is None:
+                        if self.started:
+                                raise RuntimeError("the main loop is running")
+                        if self._queue is None:
+                                self._queue = EventQueue(priority=self._itemPriority)
+                        try:
+                                self._poller = _ContextPoller()
+                        except _PollerUnavailable:
+                                self._poller = _WakeupPoller(self)
+                                self._wakeup = self._poller.wakeup
+                return self._poller.fd
+
+        def getPollTimeout(self):
+                """
+                Gets the longest time to wait for the descriptor returned by
+                L{getPollFd} before calling L{dispatchPending} anyway, for instance
+                when libatspi holds messages it has already read from the bus.
+
+                @@return: Delay in milliseconds, -1 for no limit
+                @@rtype: integer
+                """
+                poller = self._poller
+                if poller is None:
+                        return -1
+                if len(self._queue):
+                        return 0
+                return poller.timeout
+
+        def dispatchPending(self, count=None, timeout=None):
+                """
+                Reads pending messages from the bus and dispatches the events waiting
+                in the queue, without blocking. Call it when the descriptor returned
+                by L{getPollFd} is readable or L{getPollTimeout} has expired.
+
+                @@param count: Maximum number of events to dispatch, None for no limit
+                @@type count: integer
+                @@param timeout: Maximum time to spend, in seconds, None for no limit
+                @@type timeout: float
+                @@return: Number of events still queued. The descriptor is not readable
+                        for them; L{getPollTimeout} is 0 while this is not 0.
+                @@rtype: integer
+                """
+                remaining = self.pumpQueuedEvents(count, timeout)
+                poller = self._poller
+                if poller is not None:
+                        poller.update()
+                return remaining
+
+        def closePollFd(self):
                 """
-                Dispatch events that have been queued.
+                Closes the descriptor returned by L{getPollFd}. Events still queued
+                can be dispatched with L{pumpQueuedEvents}.
                 """
-                pass
+                poller, self._poller = self._poller, None
+                if poller is not None:
+                        if isinstance(poller, _WakeupPoller):
+                                self._wakeup = None
+                        poller.close()
 
 def set_default_registry (main_loop, app_name=None):
         registry = Registry ()
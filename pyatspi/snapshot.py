@@ -0,0 +1,225 @@
+#This library is free software; you can redistribute it and/or
+#modify it under the terms of the GNU Lesser General Public
+#License version 2 as published by the Free Software Foundation.
+
+#This program is distributed in the hope that it will be useful,
+#but WITHOUT ANY WARRANTY; without even the implied warranty of
+#MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#GNU General Public License for more details.
+#You should have received a copy of the GNU Lesser General Public License
+#along with this program; if not, write to the Free Software
+#Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+from array import array
+
+from pyatspi.constants import DESKTOP_COORDS
+from pyatspi.utils import _children
+
+__all__ = [
+           "TreeSnapshot",
+           "snapshotTree",
+          ]
+
+#------------------------------------------------------------------------------
+
+FIELDS = ('role', 'states', 'name', 'description', 'extents')
+
+class TreeSnapshot(object):
+        """
+        Copy of a subtree taken by L{snapshotTree}, stored as parallel arrays
+        indexed by node number. Nodes are numbered breadth first from 0, the
+        root, so the children of a node are consecutive and navigating in any
+        direction is a constant time array lookup.
+
+        Strings are interned: name and description hold indices into strings,
+        where 0 is the empty string.
+
+        @ivar parent: Index of the parent of each node, -1 for the root
+        @type parent: array
+        @ivar first_child: Index of the first child of each node
+        @type first_child: array
+        @ivar child_count: Number of children of each node
+        @type child_count: array
+        @ivar depth: Depth of each node, 0 for the root
+        @type depth: array
+        @ivar role: Role of each node, if snapshotted
+        @type role: array
+        @ivar states: State bitmask of each node, if snapshotted
+        @type states: array
+        @ivar name: String index of the name of each node, if snapshotted
+        @type name: array
+        @ivar description: String index of the description, if snapshotted
+        @type description: array
+        @ivar x: Extents of each node, if snapshotted, along with y, width and
+                height. The width and height are -1 for objects without extents.
+        @type x: array
+        @ivar strings: Interned strings
+        @type strings: list of string
+        @ivar objects: Accessible of each node, or None if they were not kept
+        @type objects: list
+        """
+
+        def __init__(self, fields):
+                self.fields = fields
+                self.parent = array('l')
+                self.first_child = array('l')
+                self.child_count = array('l')
+                self.depth = array('l')
+                self.role = array('l') if 'role' in fields else None
+                self.states = array('Q') if 'states' in fields else None
+                self.name = array('l') if 'name' in fields else None
+                self.description = array('l') if 'description' in fields else None
+                if 'extents' in fields:
+                        self.x, self.y, self.width, self.height = (array('l') for i in range(4))
+                else:
+                        self.x = self.y = self.width = self.height = None
+                self.strings = ['']
+                self._string_ids = {'': 0}
+                self.objects = []
+
+        def __len__(self):
+                return len(self.parent)
+
+        def _intern(self, value):
+                value = value or ''
+                try:
+                        return self._string_ids[value]
+                except KeyError:
+                        index = self._string_ids[value] = len(self.strings)
+                        self.strings.append(value)
+                        return index
+
+        def children(self, i):
+                """
+                @return: Indices of the children of node i
+                @rtype: range
+                """
+                first = self.first_child[i]
+                return range(first, first + self.child_count[i])
+
+        def getParent(self, i):
+                return self.parent[i]
+
+        def getName(self, i):
+                return self.strings[self.name[i]]
+
+        def getDescription(self, i):
+                return self.strings[self.description[i]]
+
+        def hasState(self, i, state):
+                return bool(self.states[i] >> int(state) & 1)
+
+        def getExtents(self, i):
+                """
+                @return: x, y, width and height of node i
+                @rtype: tuple
+                """
+                return (self.x[i], self.y[i], self.width[i], self.height[i])
+
+        def accessible(self, i):
+                """
+                @return: The live accessible of node i, to go back to the application
+                @rtype: Accessibility.Accessible
+                @raise ValueError: When the snapshot was taken without keep_objects
+                """
+                if self.objects is None:
+                        raise ValueError("the snapshot was taken without keeping the accessibles")
+                return self.objects[i]
+
+        def _record(self, acc, coord_type):
+                if self.role is not None:
+                        try:
+                                role = int(acc.getRole())
+                        except Exception:
+                                role = 0
+                        self.role.append(role)
+                if self.states is not None:
+                        try:
+                                states = acc.getState().states
+                        except Exception:
+                                states = 0
+                        self.states.append(states)
+                if self.name is not None:
+                        try:
+                                name = acc.name
+                        except Exception:
+                                name = None
+                        self.name.append(self._intern(name))
+                if self.description is not None:
+                        try:
+                                description = acc.description
+                        except Exception:
+                                description = None
+                        self.description.append(self._intern(description))
+                if self.x is not None:
+                        try:
+                                extents = acc.queryComponent().getExtents(coord_type)
+                        except Exception:
+                                extents = (0, 0, -1, -1)
+                        for column, value in zip((self.x, self.y, self.width, self.height),
+                                                 extents):
+                                column.append(value)
+
+def snapshotTree(acc, fields=('role', 'states', 'name'), max_depth=None, max_nodes=None,
+                 coord_type=DESKTOP_COORDS, keep_objects=True):
+        """
+        Walks a subtree once and copies the requested fields of every node into a
+        L{TreeSnapshot}, so that later analysis runs without any remote call.
+        Nodes which fail to answer get empty values.
+
+        @param acc: Root of the subtree
+        @type acc: Accessibility.Accessible
+        @param fields: Fields to copy, among 'role', 'states', 'name',
+                'description' and 'extents'. The structure of the tree is always
+                copied.
+        @type fields: sequence of string
+        @param max_depth: Deepest level to copy, 0 being the root, or None for no
+                limit
+        @type max_depth: integer
+        @param max_nodes: Maximum number of nodes to copy, or None for no limit
+        @type max_nodes: integer
+        @param coord_type: Coordinate system of the extents, DESKTOP_COORDS or
+                WINDOW_COORDS
+        @type coord_type: integer
+        @param keep_objects: Keep references to the accessibles, see
+                L{TreeSnapshot.accessible}. The walk holds a reference to every
+                node either way; when False, they are all released once it is
+                done.
+        @type keep_objects: boolean
+        @rtype: L{TreeSnapshot}
+        @raise ValueError: When a field is unknown
+        """
+        for field in fields:
+                if field not in FIELDS:
+                        raise ValueError("unknown snapshot field %r" % (field,))
+        snapshot = TreeSnapshot(tuple(fields))
+        objects = []
+        visited = set((acc,))
+
+        def add(node, parent, depth):
+                snapshot.parent.append(parent)
+                snapshot.first_child.append(0)
+                snapshot.child_count.append(0)
+                snapshot.depth.append(depth)
+                snapshot._record(node, coord_type)
+                objects.append(node)
+
+        add(acc, -1, 0)
+        i = 0
+        # nodes are appended in breadth first order, so the snapshot itself is
+        # the queue of nodes left to expand
+        while i < len(objects):
+                depth = snapshot.depth[i]
+                snapshot.first_child[i] = len(objects)
+                if max_depth is None or depth < max_depth:
+                        for child in _children(objects[i]):
+                                if max_nodes is not None and len(objects) >= max_nodes:
+                                        break
+                                if child is None or child in visited:
+                                        continue
+                                visited.add(child)
+                                add(child, i, depth + 1)
+                snapshot.child_count[i] = len(objects) - snapshot.first_child[i]
+                i += 1
+        snapshot.objects = objects if keep_objects else None
+        return snapshot
@@ -19,8 +19,18 @@
 
 #authors: Peter Parente, Mark Doffman
 
+import collections
+import time
+
+from gi.repository import Atspi
+from gi.repository import Gio
+from gi.repository import GLib
+
 import pyatspi.Accessibility
+from pyatspi.cachestats import caches, getCacheStats
 from pyatspi.deviceevent import allModifiers
+from pyatspi.parentcache import ParentCache
+from pyatspi.pipeline import AccessibleReference, _a11yBus
 import pyatspi.state as state
 import pyatspi.registry as registry
 
@@ -31,6 +41,7 @@ __all__ = [
                 "getCacheLevel",
                 "clearCache",
                 "printCache",
+                "getCacheStats",
                 "getInterfaceIID",
                 "getInterfaceName",
                 "listInterfaces",
@@ -38,10 +49,13 @@ __all__ = [
                 "stateToString",
                 "relationToString",
                 "allModifiers",
+                "iterDescendants",
                 "findDescendant",
                 "findAllDescendants",
+                "findAllDescendantsParallel",
                 "findAncestor",
                 "getPath",
+                "setParentCacheEnabled",
                 "pointToList",
                 "rectToList",
                 "attributeListToHash",
@@ -49,17 +63,124 @@ __all__ = [
                 "getBoundingBox"
          ]
 
-def setCacheLevel(level):
-        pass
+# named cache levels, mapped to the data libatspi keeps for each object
+CACHE_LEVELS = {
+        'none': Atspi.Cache.NONE,
+        'structure': Atspi.Cache.PARENT | Atspi.Cache.CHILDREN,
+        'default': Atspi.Cache.DEFAULT,
+        'all': Atspi.Cache.ALL,
+}
+
+_cache_level = None
+_cache_mask = None
+
+def _applications():
+        desktop = Atspi.get_desktop(0)
+        apps = [desktop]
+        try:
+                apps.extend(app for app in desktop if app is not None)
+        except Exception:
+                pass
+        return apps
+
+def setCacheLevel(level, acc=None):
+        """
+        Sets what libatspi caches about the objects of applications, either for
+        every application or for the application of one accessible. Applications
+        started later follow the global level: it is applied to them when the
+        desktop announces them.
+
+        @param level: 'none', 'structure' (parents and children), 'default',
+                'all', or an Atspi.Cache mask
+        @type level: string or integer
+        @param acc: Accessible whose application is affected, or None for all
+        @type acc: Accessibility.Accessible
+        @return: Number of applications whose cache mask was set; the others
+                went away or did not answer
+        @rtype: integer
+        @raise ValueError: When the level is unknown
+        """
+        global _cache_level, _cache_mask
+        if isinstance(level, str):
+                try:
+                        mask = CACHE_LEVELS[level]
+                except KeyError:
+                        raise ValueError("unknown cache level %r" % (level,))
+        else:
+                mask = level
+        if acc is None:
+                targets = _applications()
+                if _cache_mask is None:
+                        from pyatspi.eventfilter import EventFilter
+                        registry.Registry().registerEventListener(
+                                _applyCacheLevel, 'object:children-changed:add',
+                                filter=EventFilter(applications=registry._DESKTOP_BUS_NAME))
+                _cache_level = level
+                _cache_mask = mask
+        else:
+                targets = [acc.getApplication()]
+        updated = 0
+        for app in targets:
+                try:
+                        app.setCacheMask(mask)
+                except Exception:
+                        continue
+                updated += 1
+        return updated
+
+def _applyCacheLevel(event):
+        """
+        Gives the global cache level to an application the desktop announces.
+        """
+        try:
+                event.any_data.setCacheMask(_cache_mask)
+        except Exception:
+                # gone already
+                pass
 
 def getCacheLevel():
-        return None
+        """
+        @return: Level given to the last global L{setCacheLevel}, or None if the
+                libatspi default is in use
+        @rtype: string or integer
+        """
+        return _cache_level
 
-def clearCache():
-        pass
+def clearCache(acc=None):
+        """
+        Drops cached data so that it is fetched again from the applications.
+
+        @param acc: Accessible whose cached data, and that of its descendants, is
+                dropped, or None to drop everything cached by libatspi and by pyatspi
+        @type acc: Accessibility.Accessible
+        """
+        if acc is not None:
+                acc.clearCache()
+                return
+        for app in _applications():
+                try:
+                        app.clearCache()
+                except Exception:
+                        pass
+        for counter in caches():
+                counter.clear()
 
 def printCache():
-        print("Print cache function is deprecated")
+        """
+        Prints the cache level and the size, hit, miss and eviction counters of
+        the caches kept by pyatspi, see L{getCacheStats}.
+        """
+        level = _cache_level
+        print("cache level: %s" % (level if level is not None else "libatspi default"))
+        stats = getCacheStats()
+        for name in sorted(stats):
+                counters = stats[name]
+                ratio = counters["hit_ratio"]
+                print("%-16s size %-8s hits %-8d misses %-8d hit ratio %-6s evictions %d" %
+                      (name, counters["size"] if counters["size"] is not None else "-",
+                       counters["hits"], counters["misses"],
+                       "%.2f" % ratio if ratio is not None else "-",
+                       counters["evictions"]))
 
 def getInterfaceIID(obj):
         """
@@ -161,8 +282,109 @@ def relationToString(value):
         """
         return pyatspi.Accessibility.RELATION_VALUE_TO_NAME.get(value)
 
+def _busName(acc):
+        """
+        Gets the D-Bus name of the application an accessible, or the source of
+        a replayed event, belongs to, without any remote call.
+
+        @return: Bus name, or None when it is not known
+        @rtype: string
+        """
+        try:
+                return acc.app.bus_name
+        except AttributeError:
+                return getattr(acc, 'bus_name', None)
+
+def _role(acc):
+        """
+        Gets the role of an accessible. libatspi keeps the role it got with the
+        object; asking for it is only a round-trip when it was not cached.
+        """
+        role = getattr(acc, 'role', None)
+        if not role:
+                role = acc.getRole()
+        return role
+
+def _children(acc):
+        """
+        Gets the children of a node, or an empty list when they cannot be
+        retrieved, for instance because the node went away.
+        """
+        try:
+                return list(acc)
+        except Exception:
+                return []
 
-def findDescendant(acc, pred, breadth_first=False):
+def iterDescendants(acc, breadth_first=False, max_depth=None, prune=None, max_nodes=None):
+        """
+        Iterates over the descendants of a node, in depth-first pre-order by
+        default or in breadth first order if breadth_first is True. This is the
+        traversal behind L{findDescendant} and L{findAllDescendants}. It keeps an
+        explicit stack or queue instead of recursing, so deep trees cannot
+        exhaust the Python stack, and it remembers the nodes it has seen so that
+        an inconsistent tree where a node is its own descendant is walked once.
+
+        @param acc: Root accessible of the traversal, not included
+        @type acc: Accessibility.Accessible
+        @param breadth_first: Traverse breadth first (True) or depth first (False)?
+        @type breadth_first: boolean
+        @param max_depth: Deepest level to visit, 1 being the children of acc, or
+                None for no limit
+        @type max_depth: integer
+        @param prune: Predicate returning True for nodes whose descendants must be
+                skipped. The node itself is still visited.
+        @type prune: callable
+        @param max_nodes: Maximum number of nodes to visit, or None for no limit
+        @type max_nodes: integer
+        @return: Descendant nodes
+        @rtype: iterator
+        """
+        pending = collections.deque(((acc, 0),))
+        take = pending.popleft if breadth_first else pending.pop
+        visited = set((acc,))
+        count = 0
+        while pending:
+                node, depth = take()
+                if depth:
+                        yield node
+                        count += 1
+                        if max_nodes is not None and count >= max_nodes:
+                                return
+                        if prune is not None:
+                                try:
+                                        if prune(node):
+                                                continue
+                                except Exception:
+                                        pass
+                if max_depth is not None and depth >= max_depth:
+                        continue
+                children = _children(node)
+                if not breadth_first:
+                        # the first child is popped first
+                        children.reverse()
+                for child in children:
+                        if child is None or child in visited:
+                                continue
+                        visited.add(child)
+                        pending.append((child, depth + 1))
+
+def _findAllRemote(acc, pred, max_depth, prune, max_nodes, count=0):
+        """
+        Lets a predicate which can search by itself, like L{Match}, run the search
+        in the application with a single call. Only done for unlimited searches,
+        which Collection can express.
+
+        @return: Matches in depth-first order, or None to search node by node
+        @rtype: list or None
+        """
+        find_all = getattr(pred, 'findAll', None)
+        if find_all is None or max_depth is not None or prune is not None or \
+           max_nodes is not None:
+                return None
+        return find_all(acc, count)
+
+def findDescendant(acc, pred, breadth_first=False, max_depth=None, prune=None,
+                   max_nodes=None):
         """
         Searches for a descendant node satisfying the given predicate starting at 
         this node. The search is performed in depth-first order by default or
@@ -171,8 +393,8 @@ def findDescendant(acc, pred, breadth_first=False):
         my_win = findDescendant(lambda x: x.name == 'My Window')
 
         will search all descendants of x until one is located with the name 'My
-        Window' or all nodes are exausted. Calls L{_findDescendantDepth} or
-        L{_findDescendantBreadth} to start the recursive search.
+        Window' or all nodes are exausted. See L{iterDescendants} for the
+        traversal and its limits.
 
         @param acc: Root accessible of the search
         @type acc: Accessibility.Accessible
@@ -181,103 +403,291 @@ def findDescendant(acc, pred, breadth_first=False):
         @type pred: callable
         @param breadth_first: Search breadth first (True) or depth first (False)?
         @type breadth_first: boolean
+        @param max_depth: Deepest level to search, or None for no limit
+        @type max_depth: integer
+        @param prune: Predicate returning True for nodes whose descendants must not
+                be searched
+        @type prune: callable
+        @param max_nodes: Maximum number of nodes to test, or None for no limit
+        @type max_nodes: integer
         @return: Accessible matching the criteria or None if not found
         @rtype: Accessibility.Accessible or None
         """
-        if breadth_first:
-                return _findDescendantBreadth(acc, pred)
-
-        for child in acc:
+        if not breadth_first:
+                matches = _findAllRemote(acc, pred, max_depth, prune, max_nodes, 1)
+                if matches is not None:
+                        return matches[0] if matches else None
+        for node in iterDescendants(acc, breadth_first, max_depth, prune, max_nodes):
                 try:
-                        ret = _findDescendantDepth(acc, pred)
+                        if pred(node): return node
                 except Exception:
-                        ret = None
-                if ret is not None: return ret
+                        pass
+        return None
 
-def _findDescendantBreadth(acc, pred):
+def findAllDescendants(acc, pred, max_depth=None, prune=None, max_nodes=None):
         """
-        Internal function for locating one descendant. Called by L{findDescendant} to
-        start the search.
+        Searches for all descendant nodes satisfying the given predicate starting at 
+        this node. Does an in-order traversal. For example,
+
+        pred = lambda x: x.getRole() == pyatspi.ROLE_PUSH_BUTTON
+        buttons = pyatspi.findAllDescendants(node, pred)
+
+        will locate all push button descendants of node.
 
         @param acc: Root accessible of the search
         @type acc: Accessibility.Accessible
         @param pred: Search predicate returning True if accessible matches the 
                         search criteria or False otherwise
         @type pred: callable
-        @return: Matching node or None to keep searching
-        @rtype: Accessibility.Accessible or None
+        @param max_depth: Deepest level to search, or None for no limit
+        @type max_depth: integer
+        @param prune: Predicate returning True for nodes whose descendants must not
+                be searched
+        @type prune: callable
+        @param max_nodes: Maximum number of nodes to test, or None for no limit
+        @type max_nodes: integer
+        @return: All nodes matching the search criteria
+        @rtype: list
         """
-        for child in acc:
+        matches = _findAllRemote(acc, pred, max_depth, prune, max_nodes)
+        if matches is not None:
+                return matches
+        matches = []
+        for node in iterDescendants(acc, False, max_depth, prune, max_nodes):
                 try:
-                        if pred(child): return child
+                        if pred(node): matches.append(node)
                 except Exception:
                         pass
-        for child in acc:
+        return matches
+
+_search_bus = None
+
+def _searchBus():
+        """
+        Gets the connection to the accessibility bus used by
+        L{findAllDescendantsParallel}, or None when it cannot be opened.
+        """
+        global _search_bus
+        if _search_bus is None:
                 try:
-                        ret = _findDescendantBreadth(child, pred)
-                except Exception:
-                        ret = None
-                if ret is not None: return ret
+                        _search_bus = _a11yBus()
+                except GLib.Error:
+                        _search_bus = False
+        return _search_bus or None
 
-def _findDescendantDepth(acc, pred):
+# outcome of a remote search which did not answer in time
+_TIMED_OUT = -1
+
+def _searchRemote(roots, rule, name, workers, timeout):
+        """
+        Sends Collection.GetMatches to every root at once, as asynchronous D-Bus
+        calls from this thread, at most workers at a time, and builds the
+        matches from the references in the replies. With a name pattern, the
+        names of the matches are then read the same way and checked.
+
+        @return: For each root, the list of its matches as
+                L{AccessibleReference}s, _TIMED_OUT, or None when it has to be
+                searched through libatspi, for instance because it does not
+                implement Collection
+        @rtype: list
         """
-        Internal function for locating one descendant. Called by L{findDescendant} to
-        start the search.
+        results = [None] * len(roots)
+        bus = _searchBus()
+        if bus is None:
+                return results
+        args = GLib.Variant('(%suib)' % rule.get_type_string(),
+                            (rule.unpack(), int(pyatspi.Accessibility.Collection.SORT_ORDER_CANONICAL),
+                             0, True))
+        timeout_ms = -1 if timeout is None else max(1, int(timeout * 1000))
+        context = GLib.MainContext()
+        waiting = collections.deque()
+        in_flight = [0]
+        names = {}
+
+        def start():
+                while waiting and in_flight[0] < workers:
+                        bus_name, path, interface, method, call_args, handler = waiting.popleft()
+                        context.push_thread_default()
+                        try:
+                                bus.call(bus_name, path, interface, method, call_args, None,
+                                         Gio.DBusCallFlags.NO_AUTO_START, timeout_ms,
+                                         None, reply, handler)
+                        except Exception:
+                                continue
+                        finally:
+                                context.pop_thread_default()
+                        in_flight[0] += 1
+
+        def reply(connection, result, handler):
+                in_flight[0] -= 1
+                try:
+                        value = connection.call_finish(result).unpack()[0]
+                except GLib.Error as e:
+                        handler(None, e.matches(Gio.io_error_quark(),
+                                                Gio.IOErrorEnum.TIMED_OUT))
+                except Exception:
+                        handler(None, False)
+                else:
+                        handler(value, False)
+                start()
+
+        def matchesOf(i):
+                def handler(refs, timed_out):
+                        if timed_out:
+                                results[i] = _TIMED_OUT
+                        if refs is None:
+                                return
+                        results[i] = [AccessibleReference(*ref) for ref in refs]
+                        if name is not None:
+                                for match in results[i]:
+                                        waiting.append((match.bus_name, match.path,
+                                                        'org.freedesktop.DBus.Properties', 'Get',
+                                                        GLib.Variant('(ss)', ('org.a11y.atspi.Accessible',
+                                                                              'Name')),
+                                                        nameOf(i, match)))
+                return handler
+
+        def nameOf(i, match):
+                def handler(value, timed_out):
+                        if timed_out:
+                                results[i] = _TIMED_OUT
+                        elif value is not None:
+                                names[match] = value
+                return handler
+
+        for i, root in enumerate(roots):
+                try:
+                        bus_name, path = root.app.bus_name, root.path
+                except AttributeError:
+                        continue
+                waiting.append((bus_name, path, 'org.a11y.atspi.Collection', 'GetMatches',
+                                args, matchesOf(i)))
+        start()
+        while in_flight[0]:
+                context.iteration(True)
+        if name is not None:
+                # matches which went away before their name was read are dropped
+                for i, matches in enumerate(results):
+                        if isinstance(matches, list):
+                                results[i] = [match for match in matches
+                                              if name.search(names.get(match) or '')]
+        return results
+
+def _searchSubtree(root, pred, max_depth, prune, max_nodes, deadline):
+        """
+        Searches root and its descendants for L{findAllDescendantsParallel}.
 
-        @param acc: Root accessible of the search
-        @type acc: Accessibility.Accessible
-        @param pred: Search predicate returning True if accessible matches the 
-                search criteria or False otherwise
-        @type pred: callable
-        @return: Matching node or None to keep searching
-        @rtype: Accessibility.Accessible or None
+        @return: A pair (matches, complete), complete being False when the
+                deadline passed before the subtree was walked
+        @rtype: tuple
         """
+        matches = []
         try:
-                if pred(acc): return acc
+                if pred(root): matches.append(root)
         except Exception:
                 pass
-        for child in acc:
+        if prune is not None:
                 try:
-                        ret = _findDescendantDepth(child, pred)
+                        if prune(root):
+                                return (matches, True)
                 except Exception:
-                        ret = None
-                if ret is not None: return ret
+                        pass
+        if max_depth is not None:
+                max_depth -= 1
+                if max_depth <= 0:
+                        return (matches, True)
+        if deadline is not None and time.monotonic() > deadline:
+                return (matches, False)
+        remote = _findAllRemote(root, pred, max_depth, prune, max_nodes)
+        if remote is not None:
+                return (matches + remote, True)
+        for node in iterDescendants(root, False, max_depth, prune, max_nodes):
+                if deadline is not None and time.monotonic() > deadline:
+                        return (matches, False)
+                try:
+                        if pred(node): matches.append(node)
+                except Exception:
+                        pass
+        return (matches, True)
 
-def findAllDescendants(acc, pred):
+def findAllDescendantsParallel(acc, pred, workers=8, timeout=None, max_depth=None,
+                               prune=None, max_nodes=None, timed_out=None):
         """
-        Searches for all descendant nodes satisfying the given predicate starting at 
-        this node. Does an in-order traversal. For example,
-
-        pred = lambda x: x.getRole() == pyatspi.ROLE_PUSH_BUTTON
-        buttons = pyatspi.findAllDescendants(node, pred)
-
-        will locate all push button descendants of node.
-
-        @param acc: Root accessible of the search
+        Like L{findAllDescendants}, but meant for searches of the desktop, where
+        each child is an application that may be slow or hung. When pred is a
+        L{Match} and the search is not limited, every application is searched
+        at once through asynchronous Collection calls that do not go through
+        libatspi, so this part takes about as long as the slowest application
+        instead of the sum of all of them. The matches found this way are
+        L{AccessibleReference}s, whose fields L{Pipeline} reads without
+        libatspi. Other subtrees, like those of applications without
+        Collection, are searched node by node through libatspi, one after the
+        other, and return accessibles. Results are merged in the order of the
+        children, as findAllDescendants would return them.
+
+        Everything runs in the caller's thread: libatspi is not thread-safe.
+
+        @param acc: Root accessible of the search, usually the desktop
         @type acc: Accessibility.Accessible
-        @param pred: Search predicate returning True if accessible matches the 
-                        search criteria or False otherwise
+        @param pred: Search predicate, see L{findAllDescendants}
         @type pred: callable
+        @param workers: Number of calls in flight at once
+        @type workers: integer
+        @param timeout: Time in seconds after which the search of one subtree is
+                abandoned, or None for no limit. Each asynchronous call carries it
+                as its D-Bus timeout. In node by node searches it is checked
+                between remote calls, so a subtree can overrun it by one call,
+                itself bounded by the libatspi timeout (see L{setTimeout}).
+                Matches found before the timeout are kept.
+        @type timeout: float
+        @param max_depth: Deepest level to search, 1 being the children of acc
+        @type max_depth: integer
+        @param prune: See L{iterDescendants}. Applied to the children of acc too.
+        @type prune: callable
+        @param max_nodes: Maximum number of nodes to test in each subtree
+        @type max_nodes: integer
+        @param timed_out: List to which the children whose search timed out are
+                appended
+        @type timed_out: list
         @return: All nodes matching the search criteria
         @rtype: list
         """
-        matches = []
-        _findAllDescendants(acc, pred, matches)
-        return matches
-
-def _findAllDescendants(acc, pred, matches):
-        """
-        Internal method for collecting all descendants. Reuses the same matches
-        list so a new one does not need to be built on each recursive step.
-        """
-        for child in acc:
+        roots = [child for child in _children(acc) if child is not None]
+        if not roots:
+                return []
+        remote = [None] * len(roots)
+        rule = getattr(pred, '_ruleVariant', None)
+        if rule is not None and max_depth is None and prune is None and max_nodes is None:
                 try:
-                        if pred(child): matches.append(child)
+                        remote = _searchRemote(roots, rule(), getattr(pred, 'name', None),
+                                               max(1, workers), timeout)
                 except Exception:
                         pass
-                _findAllDescendants(child, pred, matches)
-        
-def findAncestor(acc, pred):
+        matches = []
+        for root, found in zip(roots, remote):
+                if found == _TIMED_OUT:
+                        if timed_out is not None:
+                                timed_out.append(root)
+                        continue
+                if found is not None:
+                        # the root itself is not part of the remote search
+                        try:
+                                if pred(root): matches.append(root)
+                        except Exception:
+                                pass
+                        matches.extend(found)
+                        continue
+                deadline = None
+                if timeout is not None:
+                        deadline = time.monotonic() + timeout
+                found, complete = _searchSubtree(root, pred, max_depth, prune,
+                                                 max_nodes, deadline)
+                matches.extend(found)
+                if not complete and timed_out is not None:
+                        timed_out.append(root)
+        return matches
+
+def findAncestor(acc, pred, max_depth=100):
         """
         Searches for an ancestor satisfying the given predicate. Note that the
         AT-SPI hierarchy is not always doubly linked. Node A may consider node B its
@@ -290,30 +700,63 @@ def findAncestor(acc, pred):
         @param pred: Search predicate returning True if accessible matches the 
                 search criteria or False otherwise
         @type pred: callable
+        @param max_depth: Maximum number of levels to climb
+        @type max_depth: integer
         @return: Node matching the criteria or None if not found
         @rtype: Accessibility.Accessible
         """
         if acc is None:
                 # guard against bad start condition
                 return None
-        tries = 0
-        while tries < 100:
-                if acc.parent is None:
-                        # stop if there is no parent and we haven't returned yet
+        cache = _parent_cache
+        visited = set((acc,))
+        for i in range(max_depth):
+                try:
+                        if cache is not None:
+                                parent = cache.lookup(acc)[0]
+                        else:
+                                parent = acc.parent
+                except Exception:
+                        return None
+                if parent is None or parent in visited:
+                        # stop at the top, or on a cycle
                         return None
                 try:
-                        if pred(acc.parent): return acc.parent
+                        if pred(parent): return parent
                 except Exception:
                         pass
-                # move to the parent
-                acc = acc.parent
-                tries = tries + 1
+                visited.add(parent)
+                acc = parent
         return None
 
+_parent_cache = None
+
+def setParentCacheEnabled(enabled=True):
+        """
+        Enables a memo of the parent and index in parent of accessibles for
+        L{getPath} and L{findAncestor}, kept correct from children-changed and
+        parent change events received by the L{Registry}. Only useful while the
+        main loop runs: without events, the memo could go stale. It is emptied
+        when the registry drops events. See L{ParentCache}.
+
+        @param enabled: Enable the memo (True) or drop it (False)?
+        @type enabled: boolean
+        """
+        global _parent_cache
+        reg = registry.Registry()
+        if enabled and _parent_cache is None:
+                _parent_cache = ParentCache(reg)
+                reg.registerEventListener(_parent_cache._onEvent, *ParentCache.EVENTS)
+        elif not enabled and _parent_cache is not None:
+                reg.deregisterEventListener(_parent_cache._onEvent, *ParentCache.EVENTS)
+                _parent_cache.clear()
+                _parent_cache = None
+
 def getPath(acc):
         """
         Gets the path from the application ancestor to the given accessible in
-        terms of its child index at each level.
+        terms of its child index at each level. With L{setParentCacheEnabled},
+        levels already walked are not fetched again.
 
         @param acc: Target accessible
         @type acc: Accessibility.Accessible
@@ -321,9 +764,22 @@ def getPath(acc):
         @rtype: list of integer
         @raise LookupError: When the application accessible cannot be reached
         """
+        cache = _parent_cache
         path = []
         tries = 0
         while tries < 100:
+                if cache is not None:
+                        try:
+                                parent, index = cache.lookup(acc, True)
+                        except Exception:
+                                raise LookupError
+                        if parent is None:
+                                path.reverse()
+                                return path
+                        path.append(index)
+                        acc = parent
+                        tries = tries + 1
+                        continue
                 if acc.parent is None:
                         path.reverse()
                         return path
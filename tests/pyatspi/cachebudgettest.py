@@ -0,0 +1,141 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+from pasytest import PasyTest as _PasyTest
+
+import pyatspi
+from pyatspi import CacheBudget
+
+from fixtures import FakeEvent, FakeNode
+
+class _Node(FakeNode):
+	"""
+	Node counting how many times its libatspi cache was cleared.
+	"""
+
+	all_cleared = 0
+
+	def __init__(self, name, *children, **kwargs):
+		FakeNode.__init__(self, name, *children, **kwargs)
+		self.cleared = 0
+		self.accessible_parent = None
+		for child in children:
+			child.accessible_parent = self
+
+	def clearCache(self):
+		self.cleared += 1
+		_Node.all_cleared += 1
+
+class CacheBudgetTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_eviction",
+		     "test_unreferenced",
+		     "test_recently_used",
+		     "test_per_application",
+		     "test_pinned",
+		     "test_forget",
+		     "test_registry",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "CacheBudget", False)
+
+	def setup(self, test):
+		pass
+
+	def test_eviction(self, test):
+		budget = CacheBudget(2)
+		nodes = [_Node("n%d" % i) for i in range(4)]
+		for node in nodes:
+			budget.touch(node)
+		test.assertEqual([node.cleared for node in nodes], [1, 1, 0, 0],
+				 "Least recently used not cleared")
+		test.assertEqual(len(budget), 2, "Budget exceeded")
+
+	def test_unreferenced(self, test):
+		# like the wrappers of event sources, which nothing else keeps
+		budget = CacheBudget(2)
+		_Node.all_cleared = 0
+		for i in range(3):
+			budget.touch(_Node("n%d" % i))
+		test.assertEqual(_Node.all_cleared, 1, "Unreferenced node not cleared")
+
+	def test_recently_used(self, test):
+		budget = CacheBudget(2)
+		a, b, c = _Node("a"), _Node("b"), _Node("c")
+		budget.touch(a)
+		budget.touch(b)
+		budget.touch(a)
+		budget.touch(c)
+		test.assertEqual((a.cleared, b.cleared), (0, 1), "Recently used node cleared")
+
+	def test_per_application(self, test):
+		budget = CacheBudget(1)
+		a, b = _Node("a", bus_name=":1.1"), _Node("b", bus_name=":1.2")
+		budget.touch(a)
+		budget.touch(b)
+		test.assertEqual((a.cleared, b.cleared), (0, 0),
+				 "Node cleared for another application")
+		test.assertEqual(len(budget), 2, "Wrong tracked count")
+
+	def test_pinned(self, test):
+		budget = CacheBudget(2)
+		button = _Node("button")
+		frame = _Node("frame", _Node("panel", button))
+		budget.focus(button)
+		others = [_Node("n%d" % i) for i in range(3)]
+		for node in others:
+			budget.touch(node)
+		test.assertEqual(button.cleared + frame.cleared, 0, "Focused ancestry cleared")
+		test.assertEqual([node.cleared for node in others], [1, 1, 0],
+				 "Unpinned nodes kept")
+		# focus moves: the old ancestry can go
+		budget.focus(others[0])
+		test.assertEqual(frame.cleared, 1, "Previously focused ancestry still pinned")
+
+	def test_forget(self, test):
+		budget = CacheBudget(2)
+		a, b = _Node("a", bus_name=":1.1"), _Node("b", bus_name=":1.2")
+		budget.touch(a)
+		budget.touch(b)
+		budget.forget(":1.1")
+		test.assertEqual(len(budget), 1, "Application not forgotten")
+		test.assertEqual(budget.clear(), 1, "Wrong number of nodes forgotten")
+		test.assertEqual(len(budget), 0, "Nodes left after clear")
+
+	def test_registry(self, test):
+		registry = pyatspi.Registry
+		registry.setCacheBudget(1)
+		try:
+			a, b = _Node("a"), _Node("b")
+			registry._deliverEvent(FakeEvent("object:state-changed:showing", a, 1))
+			registry._deliverEvent(FakeEvent("object:state-changed:showing", b, 1))
+			test.assertEqual(a.cleared, 1, "Event source not tracked")
+			desktop = FakeNode("desktop", bus_name="org.a11y.atspi.Registry")
+			registry._deliverEvent(FakeEvent("object:children-changed:remove", desktop,
+							 0, 0, FakeNode("app")))
+			# only the desktop, source of the last event, is left
+			test.assertEqual(len(registry.getCacheBudget()), 1,
+					 "Application leaving not forgotten")
+		finally:
+			registry.setCacheBudget(None)
+		test.assertEqual(registry.getCacheBudget(), None, "Budget not removed")
+
+	def teardown(self, test):
+		pass
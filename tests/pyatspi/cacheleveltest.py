@@ -0,0 +1,112 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+from pasytest import PasyTest as _PasyTest
+
+import pyatspi
+import pyatspi.utils
+
+from fixtures import FakeEvent, FakeNode
+
+class _Application(FakeNode):
+	def __init__(self, name, alive=True):
+		FakeNode.__init__(self, name, bus_name=":1." + name)
+		self.alive = alive
+		self.mask = None
+		self.cleared = 0
+
+	def setCacheMask(self, mask):
+		if not self.alive:
+			raise RuntimeError("The application no longer exists")
+		self.mask = mask
+
+	def clearCache(self):
+		self.cleared += 1
+
+	def getApplication(self):
+		return self
+
+class CacheLevelTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_level",
+		     "test_unknown_level",
+		     "test_one_application",
+		     "test_later_application",
+		     "test_clear",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "CacheLevel", False)
+
+	def setup(self, test):
+		self.saved = pyatspi.utils._applications
+		self.apps = [_Application("1"), _Application("2"), _Application("3", alive=False)]
+		pyatspi.utils._applications = lambda: list(self.apps)
+
+	def test_level(self, test):
+		test.assertEqual(pyatspi.setCacheLevel("structure"), 2,
+				 "Wrong number of applications updated")
+		test.assertEqual([app.mask for app in self.apps[:2]],
+				 [pyatspi.utils.CACHE_LEVELS["structure"]] * 2, "Mask not set")
+		test.assertEqual(pyatspi.getCacheLevel(), "structure", "Level not kept")
+
+	def test_unknown_level(self, test):
+		try:
+			pyatspi.setCacheLevel("some")
+		except ValueError:
+			pass
+		else:
+			test.fail("Unknown level accepted")
+		test.assertEqual(pyatspi.getCacheLevel(), "structure", "Level changed")
+
+	def test_one_application(self, test):
+		test.assertEqual(pyatspi.setCacheLevel("all", self.apps[1]), 1,
+				 "Wrong number of applications updated")
+		test.assertEqual(self.apps[1].mask, pyatspi.utils.CACHE_LEVELS["all"],
+				 "Mask not set")
+		test.assertEqual(self.apps[0].mask, pyatspi.utils.CACHE_LEVELS["structure"],
+				 "Mask of another application set")
+		test.assertEqual(pyatspi.getCacheLevel(), "structure", "Global level changed")
+
+	def test_later_application(self, test):
+		desktop = FakeNode("desktop", bus_name="org.a11y.atspi.Registry")
+		other = FakeNode("frame")
+		app = _Application("4")
+		# announced by something else than the desktop
+		pyatspi.Registry._deliverEvent(FakeEvent("object:children-changed:add", other,
+							 0, 0, app))
+		test.assertEqual(app.mask, None, "Level given to a child of an application")
+		pyatspi.Registry._deliverEvent(FakeEvent("object:children-changed:add", desktop,
+							 3, 0, app))
+		test.assertEqual(app.mask, pyatspi.utils.CACHE_LEVELS["structure"],
+				 "Level not given to a new application")
+
+	def test_clear(self, test):
+		pyatspi.clearCache(self.apps[0])
+		test.assertEqual([app.cleared for app in self.apps], [1, 0, 0],
+				 "Wrong application cleared")
+		pyatspi.clearCache()
+		test.assertEqual([app.cleared for app in self.apps], [2, 1, 1],
+				 "Applications not all cleared")
+
+	def teardown(self, test):
+		pyatspi.utils._applications = self.saved
+		pyatspi.Registry.deregisterEventListener(pyatspi.utils._applyCacheLevel,
+							 "object:children-changed:add")
+		pyatspi.utils._cache_level = pyatspi.utils._cache_mask = None
@@ -0,0 +1,89 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+from pasytest import PasyTest as _PasyTest
+
+import pyatspi
+from pyatspi.Accessibility import Accessible_getChildren
+
+from fixtures import FakeNode, names
+
+class _Collection(object):
+	def __init__(self, node):
+		self.node = node
+		self.calls = []
+
+	def createMatchRule(self, *args):
+		return args
+
+	def getMatches(self, rule, sortby, count, traverse):
+		self.calls.append((sortby, count, traverse))
+		return list(self.node.children)
+
+class _Node(FakeNode):
+	"""
+	Node read through the libatspi accessors, counting the remote calls.
+	"""
+
+	def __init__(self, name, *children, **kwargs):
+		FakeNode.__init__(self, name, *children)
+		self.collection = _Collection(self) if kwargs.get("collection") else None
+
+	def queryCollection(self):
+		if self.collection is None:
+			raise NotImplementedError
+		return self.collection
+
+	def get_child_count(self):
+		self.calls += 1
+		return len(self.children)
+
+	def get_child_at_index(self, i):
+		self.calls += 1
+		return self.children[i]
+
+class ChildrenTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_collection",
+		     "test_by_index",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "Children", False)
+
+	def setup(self, test):
+		pass
+
+	def test_collection(self, test):
+		node = _Node("list", _Node("a"), _Node("b"), _Node("c"), collection=True)
+		test.assertEqual(names(Accessible_getChildren(node)), ["a", "b", "c"],
+				 "Wrong children")
+		test.assertEqual(node.collection.calls,
+				 [(pyatspi.Collection.SORT_ORDER_CANONICAL, 0, False)],
+				 "Children not read with one call limited to them")
+		test.assertEqual(node.calls, 0, "Children read by index")
+
+	def test_by_index(self, test):
+		node = _Node("list", _Node("a"), _Node("b"), _Node("c"))
+		test.assertEqual(names(Accessible_getChildren(node)), ["a", "b", "c"],
+				 "Wrong children")
+		test.assertEqual(node.calls, 4, "Child count not read once")
+
+	def teardown(self, test):
+		pass
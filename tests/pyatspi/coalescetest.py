@@ -0,0 +1,147 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+import time
+
+from gi.repository import GLib
+
+from pasytest import PasyTest as _PasyTest
+
+import pyatspi
+
+from fixtures import FakeEvent, FakeNode
+
+WINDOW = 0.02
+
+def _expire():
+	"""
+	Lets the coalescing windows expire and their timeouts run.
+	"""
+	time.sleep(WINDOW * 2)
+	context = GLib.MainContext.default()
+	while context.pending():
+		context.iteration(False)
+
+class CoalesceTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_merge",
+		     "test_other_types",
+		     "test_children",
+		     "test_per_type",
+		     "test_disable",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "Coalesce", False)
+
+	def setup(self, test):
+		self.registry = pyatspi.Registry
+		self.received = []
+
+	def _client(self, event):
+		self.received.append(event)
+
+	def _deliver(self, *events):
+		for event in events:
+			self.registry._deliverEvent(event)
+
+	def _register(self, *names, **kwargs):
+		self.received = []
+		self.registry.registerEventListener(self._client, *names, **kwargs)
+
+	def _deregister(self, *names):
+		self.registry.deregisterEventListener(self._client, *names)
+
+	def test_merge(self, test):
+		button = FakeNode("button")
+		label = FakeNode("label")
+		self._register("object:bounds-changed", coalesce=WINDOW)
+		try:
+			self._deliver(FakeEvent("object:bounds-changed", button, 1),
+				      FakeEvent("object:bounds-changed", label, 1),
+				      FakeEvent("object:bounds-changed", button, 2),
+				      FakeEvent("object:bounds-changed", button, 3))
+			test.assertEqual(self.received, [], "Events delivered within the window")
+			_expire()
+		finally:
+			self._deregister("object:bounds-changed")
+		test.assertEqual([(event.source.name, event.detail1, event.coalesced)
+				  for event in self.received],
+				 [("button", 3, 3), ("label", 1, 1)],
+				 "Latest event of each source not delivered in first seen order")
+
+	def test_other_types(self, test):
+		button = FakeNode("button")
+		self._register("object:bounds-changed", coalesce=WINDOW)
+		self.registry.registerEventListener(self._client, "object:state-changed:focused")
+		try:
+			self._deliver(FakeEvent("object:bounds-changed", button),
+				      FakeEvent("object:state-changed:focused", button, 1))
+			test.assertEqual([str(event.type) for event in self.received],
+					 ["object:state-changed:focused"],
+					 "Event registered without a window held back")
+			_expire()
+		finally:
+			self._deregister("object:bounds-changed", "object:state-changed:focused")
+		test.assertEqual(len(self.received), 2, "Merged event not delivered")
+
+	def test_children(self, test):
+		panel = FakeNode("panel")
+		first = FakeNode("first")
+		second = FakeNode("second")
+		self._register("object:children-changed", coalesce=WINDOW)
+		try:
+			self._deliver(FakeEvent("object:children-changed:add", panel, 0, 0, first),
+				      FakeEvent("object:children-changed:add", panel, 1, 0, second),
+				      FakeEvent("object:children-changed:add", panel, 0, 0, first))
+			_expire()
+		finally:
+			self._deregister("object:children-changed")
+		test.assertEqual([(event.any_data.name, event.coalesced) for event in self.received],
+				 [("first", 2), ("second", 1)], "Added child lost")
+
+	def test_per_type(self, test):
+		button = FakeNode("button")
+		self._register("object", coalesce={"object:bounds-changed": WINDOW})
+		try:
+			self._deliver(FakeEvent("object:bounds-changed", button),
+				      FakeEvent("object:state-changed:showing", button, 1),
+				      FakeEvent("object:bounds-changed", button))
+			test.assertEqual([str(event.type) for event in self.received],
+					 ["object:state-changed:showing"],
+					 "Type without a window held back")
+			_expire()
+		finally:
+			self._deregister("object")
+		test.assertEqual([event.coalesced for event in self.received[1:]], [2],
+				 "Type with a window not merged")
+
+	def test_disable(self, test):
+		button = FakeNode("button")
+		self._register("object:bounds-changed", coalesce=WINDOW)
+		self.registry.registerEventListener(self._client, "object:bounds-changed",
+						    coalesce=0)
+		try:
+			self._deliver(FakeEvent("object:bounds-changed", button))
+		finally:
+			self._deregister("object:bounds-changed")
+		test.assertEqual(len(self.received), 1, "Merging not stopped")
+
+	def teardown(self, test):
+		pass
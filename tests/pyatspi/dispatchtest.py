@@ -0,0 +1,72 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+import threading
+
+from pasytest import PasyTest as _PasyTest
+
+import pyatspi
+from pyatspi.eventqueue import EventQueue, QUEUE_BLOCK
+from pyatspi.eventqueue import _Dispatcher
+
+from fixtures import FakeEvent
+
+class DispatchTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_workers",
+		     "test_block_refused",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "Dispatch", False)
+
+	def setup(self, test):
+		pass
+
+	def test_workers(self, test):
+		received = []
+		threads = set()
+
+		def dispatch(event):
+			received.append(event.detail1)
+			threads.add(threading.current_thread())
+
+		queue = EventQueue(64)
+		dispatcher = _Dispatcher(queue, dispatch)
+		for i in range(32):
+			queue.put((FakeEvent("object:property-change", detail1=i),))
+		dispatcher.stop()
+		test.assertEqual(received, list(range(32)),
+				 "Events not dispatched in order by a single worker")
+		if threading.current_thread() in threads:
+			test.fail("Events dispatched from the queuing thread")
+
+	def test_block_refused(self, test):
+		registry = pyatspi.Registry
+		try:
+			registry.start(queued=True, overflow=QUEUE_BLOCK)
+		except ValueError:
+			pass
+		else:
+			test.fail("Main loop started with a blocking queue")
+		if registry.started:
+			test.fail("Registry left started")
+
+	def teardown(self, test):
+		pass
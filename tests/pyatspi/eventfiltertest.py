@@ -0,0 +1,113 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+from pasytest import PasyTest as _PasyTest
+
+import pyatspi
+from pyatspi import EventFilter
+
+from fixtures import FakeEvent, FakeNode
+
+class _GoneNode(FakeNode):
+	"""
+	Source which went away: asking for its role fails.
+	"""
+
+	def getRole(self):
+		raise RuntimeError("The application no longer exists")
+
+def _node(name, role, bus_name=":1.42"):
+	node = FakeNode(name, bus_name=bus_name)
+	node.role = role
+	return node
+
+class EventFilterTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_empty",
+		     "test_details",
+		     "test_applications",
+		     "test_roles",
+		     "test_gone",
+		     "test_registry",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "EventFilter", False)
+
+	def setup(self, test):
+		self.button = _node("button", pyatspi.ROLE_PUSH_BUTTON)
+		self.label = _node("label", pyatspi.ROLE_LABEL, bus_name=":1.7")
+
+	def test_empty(self, test):
+		if EventFilter():
+			test.fail("Filter without conditions is not empty")
+		if not EventFilter(detail1=1):
+			test.fail("Filter with a condition is empty")
+
+	def test_details(self, test):
+		event_filter = EventFilter(detail1=1, detail2=(0, 2))
+		test.assertEqual(event_filter.match(FakeEvent("object:test", self.button, 1, 2)),
+				 True, "Matching details refused")
+		test.assertEqual(event_filter.match(FakeEvent("object:test", self.button, 0, 2)),
+				 False, "Wrong detail1 accepted")
+		test.assertEqual(event_filter.match(FakeEvent("object:test", self.button, 1, 1)),
+				 False, "Wrong detail2 accepted")
+
+	def test_applications(self, test):
+		event_filter = EventFilter(applications=":1.7")
+		test.assertEqual(event_filter.match(FakeEvent("object:test", self.label)),
+				 True, "Event of the application refused")
+		test.assertEqual(event_filter.match(FakeEvent("object:test", self.button)),
+				 False, "Event of another application accepted")
+
+	def test_roles(self, test):
+		event_filter = EventFilter(roles=(pyatspi.ROLE_PUSH_BUTTON,
+						  pyatspi.ROLE_TOGGLE_BUTTON))
+		test.assertEqual(event_filter.match(FakeEvent("object:test", self.button)),
+				 True, "Event of a button refused")
+		test.assertEqual(event_filter.match(FakeEvent("object:test", self.label)),
+				 False, "Event of a label accepted")
+
+	def test_gone(self, test):
+		event_filter = EventFilter(roles=pyatspi.ROLE_PUSH_BUTTON)
+		test.assertEqual(event_filter.match(FakeEvent("object:test", _GoneNode("gone"))),
+				 False, "Event of a vanished source accepted")
+
+	def test_registry(self, test):
+		registry = pyatspi.Registry
+		received = []
+		registry.registerEventListener(received.append, "object:state-changed",
+					       filter=EventFilter(roles=pyatspi.ROLE_PUSH_BUTTON,
+								  detail1=1))
+		try:
+			registry._deliverEvent(FakeEvent("object:state-changed:focused", self.button, 1))
+			registry._deliverEvent(FakeEvent("object:state-changed:focused", self.button, 0))
+			registry._deliverEvent(FakeEvent("object:state-changed:focused", self.label, 1))
+			test.assertEqual([event.source for event in received], [self.button],
+					 "Filter not applied by the registry")
+			# an empty filter removes the conditions
+			registry.registerEventListener(received.append, "object:state-changed",
+						       filter=EventFilter())
+			registry._deliverEvent(FakeEvent("object:state-changed:focused", self.label, 1))
+			test.assertEqual(len(received), 2, "Filter not removed")
+		finally:
+			registry.deregisterEventListener(received.append, "object:state-changed")
+
+	def teardown(self, test):
+		pass
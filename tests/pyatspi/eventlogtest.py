@@ -0,0 +1,168 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+import io
+import time
+
+from pasytest import PasyTest as _PasyTest
+
+import pyatspi
+from pyatspi.eventlog import EventRecorder, EventReplayer, RecordedSource
+
+from fixtures import FakeEvent, FakeNode
+
+def _event(name, detail1=0, detail2=0, any_data=None, path="/org/a11y/atspi/accessible/1"):
+	return FakeEvent(name, FakeNode("source", path=path), detail1, detail2, any_data)
+
+class EventLogTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_round_trip",
+		     "test_appended_session",
+		     "test_long_string",
+		     "test_not_a_log",
+		     "test_truncated",
+		     "test_replay_paced",
+		     "test_replay_not_recorded",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "EventLog", False)
+
+	def setup(self, test):
+		pass
+
+	def test_round_trip(self, test):
+		log = io.BytesIO()
+		recorder = EventRecorder(log)
+		recorder.record(_event("object:state-changed:focused", 1, 0), 10.5)
+		recorder.record(_event("object:text-changed:insert", 3, 2, "hello", "/a/2"), 11.0)
+		recorder.record(_event("object:children-changed:add", 0, 0, object()), 12.0)
+		recorder.close()
+		test.assertEqual(recorder.count, 3, "Wrong number of events recorded")
+
+		events = list(EventReplayer(io.BytesIO(log.getvalue())))
+		test.assertEqual([str(event.type) for event in events],
+				 ["object:state-changed:focused",
+				  "object:text-changed:insert",
+				  "object:children-changed:add"],
+				 "Event types not read back")
+		test.assertEqual([(event.detail1, event.detail2) for event in events],
+				 [(1, 0), (3, 2), (0, 0)], "Details not read back")
+		test.assertEqual([event.timestamp for event in events],
+				 [10.5, 11.0, 12.0], "Timestamps not read back")
+		test.assertEqual([event.any_data for event in events],
+				 [None, "hello", "<object>"], "any_data not summarized")
+		test.assertEqual(events[1].source, RecordedSource(":1.42", "/a/2"),
+				 "Source address not read back")
+		if events[0].source is not events[2].source:
+			test.fail("Sources of the same object not shared")
+
+	def test_appended_session(self, test):
+		log = io.BytesIO()
+		recorder = EventRecorder(log)
+		recorder.record(_event("object:state-changed:focused"), 1.0)
+		recorder.close()
+		# the second recorder starts its own string table
+		recorder = EventRecorder(log)
+		recorder.record(_event("window:activate", path="/b"), 2.0)
+		recorder.record(_event("object:state-changed:focused"), 3.0)
+		recorder.close()
+
+		events = list(EventReplayer(io.BytesIO(log.getvalue())))
+		test.assertEqual([str(event.type) for event in events],
+				 ["object:state-changed:focused",
+				  "window:activate",
+				  "object:state-changed:focused"],
+				 "Appended session not read back")
+		test.assertEqual(events[1].source.path, "/b", "Wrong source in appended session")
+
+	def test_long_string(self, test):
+		log = io.BytesIO()
+		recorder = EventRecorder(log)
+		# two bytes per character, so the limit falls inside a character
+		recorder.record(_event("object:text-changed:insert", any_data="\u00e9" * 40000), 1.0)
+		recorder.close()
+
+		event, = EventReplayer(io.BytesIO(log.getvalue()))
+		test.assertEqual(event.any_data, "\u00e9" * 32767, "Long string not cut on a character")
+
+	def test_not_a_log(self, test):
+		try:
+			list(EventReplayer(io.BytesIO(b"not a log at all")))
+		except ValueError:
+			return
+		test.fail("Invalid log accepted")
+
+	def test_truncated(self, test):
+		log = io.BytesIO()
+		recorder = EventRecorder(log)
+		recorder.record(_event("window:activate"), 1.0)
+		complete = len(log.getvalue())
+		recorder.record(_event("window:deactivate", path="/a/new/path"), 2.0)
+		recorder.close()
+		data = log.getvalue()
+		# cut inside the records written for the second event: its new
+		# strings, then the event itself
+		for end in range(complete + 1, len(data)):
+			try:
+				events = list(EventReplayer(io.BytesIO(data[:end])))
+			except Exception as e:
+				test.fail("Log cut at %d bytes not read: %r" % (end, e))
+				return
+			test.assertEqual([str(event.type) for event in events], ["window:activate"],
+					 "Wrong events read from a log cut at %d bytes" % end)
+
+	def test_replay_paced(self, test):
+		log = io.BytesIO()
+		recorder = EventRecorder(log)
+		recorder.record(_event("window:activate"), 100.0)
+		recorder.record(_event("window:deactivate"), 100.2)
+		recorder.close()
+		registry = pyatspi.Registry
+		start = time.monotonic()
+		EventReplayer(io.BytesIO(log.getvalue())).replay(registry, speed=2.0)
+		elapsed = time.monotonic() - start
+		if not 0.09 <= elapsed < 1.0:
+			test.fail("Replay not paced: %f s" % elapsed)
+
+	def test_replay_not_recorded(self, test):
+		log = io.BytesIO()
+		recorder = EventRecorder(log)
+		recorder.record(_event("object:state-changed:focused", 1), 1.0)
+		recorder.record(_event("object:state-changed:showing", 1), 2.0)
+		recorder.close()
+
+		received = []
+		registry = pyatspi.Registry
+		registry.registerEventListener(received.append, "object:state-changed")
+		output = io.BytesIO()
+		recording = registry.startRecording(output)
+		try:
+			count = EventReplayer(io.BytesIO(log.getvalue())).replay(registry)
+		finally:
+			registry.stopRecording()
+			registry.deregisterEventListener(received.append, "object:state-changed")
+		test.assertEqual(count, 2, "Wrong number of events replayed")
+		test.assertEqual([str(event.type) for event in received],
+				 ["object:state-changed:focused", "object:state-changed:showing"],
+				 "Replayed events not delivered")
+		test.assertEqual(recording.count, 0, "Replayed events recorded again")
+
+	def teardown(self, test):
+		pass
@@ -0,0 +1,243 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+import threading
+
+from pasytest import PasyTest as _PasyTest
+
+from gi.repository import GLib
+
+import pyatspi
+from pyatspi.appevent import EventType
+from pyatspi.eventqueue import *
+
+from fixtures import FakeEvent, FakeNode
+
+def _priority(item):
+	return item[0].priority
+
+def _item(name, priority=PRIORITY_NORMAL):
+	event = FakeEvent(name)
+	event.priority = priority
+	return (event,)
+
+def _drain(queue):
+	names = []
+	while len(queue):
+		names.append(str(queue.get(False)[0].type))
+	return names
+
+class EventQueueTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_drop_oldest",
+		     "test_drop_newest",
+		     "test_drop_by_priority",
+		     "test_block",
+		     "test_closed",
+		     "test_discard",
+		     "test_dropped_on_stop",
+		     "test_drain_in_storm",
+		     "test_fifo",
+		     "test_strict",
+		     "test_weighted",
+		     "test_event_priority",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "EventQueue", False)
+
+	def setup(self, test):
+		pass
+
+	def test_drop_oldest(self, test):
+		queue = EventQueue(2, QUEUE_DROP_OLDEST, _priority)
+		for name in ("window:create", "window:activate", "window:destroy"):
+			if not queue.put(_item(name)):
+				test.fail("Newest event refused")
+		test.assertEqual(_drain(queue), ["window:activate", "window:destroy"],
+				 "Oldest event not dropped")
+		test.assertEqual(queue.dropped, 1, "Drop not counted")
+		test.assertEqual(queue.dropped_by_type, {"window:create": 1},
+				 "Drop not counted by type")
+		test.assertEqual(queue.high_water, 2, "Wrong high water mark")
+
+	def test_drop_newest(self, test):
+		queue = EventQueue(2, QUEUE_DROP_NEWEST, _priority)
+		queue.put(_item("window:create"))
+		queue.put(_item("window:activate"))
+		if queue.put(_item("window:destroy")):
+			test.fail("Event accepted by a full queue")
+		test.assertEqual(_drain(queue), ["window:create", "window:activate"],
+				 "Newest event not dropped")
+		test.assertEqual(queue.dropped_by_type, {"window:destroy": 1},
+				 "Drop not counted by type")
+
+	def test_drop_by_priority(self, test):
+		queue = EventQueue(3, QUEUE_DROP_BY_PRIORITY, _priority)
+		queue.put(_item("object:bounds-changed", PRIORITY_LOW))
+		queue.put(_item("object:state-changed:focused", PRIORITY_HIGH))
+		queue.put(_item("object:children-changed:add", PRIORITY_LOW))
+		# the oldest low priority event makes room
+		if not queue.put(_item("object:text-caret-moved", PRIORITY_HIGH)):
+			test.fail("High priority event refused")
+		test.assertEqual(queue.dropped_by_type, {"object:bounds-changed": 1},
+				 "Oldest low priority event not dropped")
+		queue.put(_item("object:text-caret-moved", PRIORITY_HIGH))
+		# nothing queued is below normal priority now
+		if queue.put(_item("object:property-change", PRIORITY_NORMAL)):
+			test.fail("Event of the lowest priority not dropped")
+		test.assertEqual(queue.dropped, 3, "Drops not counted")
+		test.assertEqual(_drain(queue),
+				 ["object:state-changed:focused",
+				  "object:text-caret-moved",
+				  "object:text-caret-moved"],
+				 "Wrong events kept")
+
+	def test_block(self, test):
+		queue = EventQueue(1, QUEUE_BLOCK, _priority)
+		queue.put(_item("window:create"))
+		done = threading.Event()
+
+		def producer():
+			queue.put(_item("window:activate"))
+			done.set()
+
+		thread = threading.Thread(target=producer)
+		thread.start()
+		if done.wait(0.1):
+			test.fail("Put did not block on a full queue")
+		test.assertEqual(str(queue.get()[0].type), "window:create", "Wrong first event")
+		thread.join(5)
+		if not done.is_set():
+			test.fail("Put not woken up by get")
+		test.assertEqual(_drain(queue), ["window:activate"], "Blocked event lost")
+		test.assertEqual(queue.dropped, 0, "Event dropped by a blocking queue")
+
+	def test_closed(self, test):
+		queue = EventQueue(4, QUEUE_DROP_OLDEST, _priority)
+		queue.put(_item("window:create"))
+		queue.close()
+		if queue.put(_item("window:activate")):
+			test.fail("Closed queue accepted an event")
+		test.assertEqual(str(queue.get()[0].type), "window:create",
+				 "Queued event lost on close")
+		try:
+			queue.get()
+		except IndexError:
+			return
+		test.fail("Get blocked or returned on an empty closed queue")
+
+	def test_discard(self, test):
+		queue = EventQueue(4, QUEUE_DROP_OLDEST, _priority)
+		queue.put(_item("window:create"))
+		queue.put(_item("window:activate"))
+		test.assertEqual(queue.discard(), 2, "Wrong number of events discarded")
+		test.assertEqual(len(queue), 0, "Queue not emptied")
+		test.assertEqual(queue.dropped, 2, "Discarded events not counted")
+
+	def test_dropped_on_stop(self, test):
+		registry = pyatspi.Registry
+		source = FakeNode("frame")
+
+		def receive():
+			for i in range(5):
+				registry._deliverEvent(FakeEvent("window:activate", source))
+			# the loop stops before the queue is drained
+			registry.stop()
+			return False
+
+		dropped = registry.getDroppedCount()
+		GLib.idle_add(receive)
+		registry.start(queued=True)
+		test.assertEqual(registry.getDroppedCount() - dropped, 5,
+				 "Events left queued not counted as dropped")
+
+	def test_drain_in_storm(self, test):
+		registry = pyatspi.Registry
+		source = FakeNode("frame")
+		received = []
+		sent = [0]
+
+		def storm():
+			# reception never lets the loop go idle
+			registry._deliverEvent(FakeEvent("window:activate", source))
+			sent[0] += 1
+			if sent[0] == 200:
+				registry.stop()
+				return False
+			return True
+
+		registry.registerEventListener(received.append, "window:activate")
+		GLib.idle_add(storm, priority=GLib.PRIORITY_DEFAULT)
+		try:
+			registry.start(queued=True)
+		finally:
+			registry.deregisterEventListener(received.append, "window:activate")
+		if len(received) < 150:
+			test.fail("Queue starved during an event storm: %d of 200 events dispatched"
+				  % len(received))
+
+	def _fill(self, queue):
+		for i in range(4):
+			queue.put(_item("object:bounds-changed", PRIORITY_LOW))
+			queue.put(_item("object:state-changed:focused", PRIORITY_HIGH))
+
+	def test_fifo(self, test):
+		queue = EventQueue(16, QUEUE_DROP_OLDEST, _priority, SCHEDULE_FIFO)
+		self._fill(queue)
+		test.assertEqual(_drain(queue),
+				 ["object:bounds-changed", "object:state-changed:focused"] * 4,
+				 "Arrival order not kept")
+
+	def test_strict(self, test):
+		queue = EventQueue(16, QUEUE_DROP_OLDEST, _priority, SCHEDULE_STRICT)
+		self._fill(queue)
+		test.assertEqual(_drain(queue),
+				 ["object:state-changed:focused"] * 4 + ["object:bounds-changed"] * 4,
+				 "High priority lane not served first")
+
+	def test_weighted(self, test):
+		queue = EventQueue(32, QUEUE_DROP_OLDEST, _priority, SCHEDULE_WEIGHTED,
+				   {PRIORITY_LOW: 1, PRIORITY_HIGH: 3})
+		for i in range(8):
+			queue.put(_item("object:bounds-changed", PRIORITY_LOW))
+			queue.put(_item("object:state-changed:focused", PRIORITY_HIGH))
+		names = _drain(queue)
+		# while both lanes are busy, one low priority event in four
+		test.assertEqual(names[:8].count("object:bounds-changed"), 2,
+				 "Lanes not shared by weight")
+		test.assertEqual(len(names), 16, "Events lost")
+
+	def test_event_priority(self, test):
+		focused = EventType.intern("object:state-changed:focused")
+		showing = EventType.intern("object:state-changed:showing")
+		test.assertEqual(eventPriority(focused), PRIORITY_HIGH, "Wrong default priority")
+		test.assertEqual(eventPriority(showing), PRIORITY_NORMAL, "Wrong default priority")
+		setEventPriority("object:state-changed", PRIORITY_LOW)
+		try:
+			test.assertEqual(eventPriority(showing), PRIORITY_LOW,
+					 "Priority of a prefix not applied")
+			test.assertEqual(eventPriority(focused), PRIORITY_HIGH,
+					 "Most specific priority not kept")
+		finally:
+			setEventPriority("object:state-changed", None)
+		test.assertEqual(eventPriority(showing), PRIORITY_NORMAL, "Priority not restored")
+
+	def teardown(self, test):
+		pass
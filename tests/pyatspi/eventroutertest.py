@@ -0,0 +1,129 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+from pasytest import PasyTest as _PasyTest
+
+from pyatspi.appevent import EventType
+from pyatspi.eventrouter import EventRouter
+
+def general(event):
+	pass
+
+def specific(event):
+	pass
+
+class EventRouterTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_add",
+		     "test_route",
+		     "test_route_once",
+		     "test_remove",
+		     "test_remove_subevents",
+		     "test_contains",
+		     "test_canonical",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "EventRouter", False)
+
+	def setup(self, test):
+		pass
+
+	def test_add(self, test):
+		router = EventRouter()
+		if not router.add(general, "object"):
+			test.fail("First client of a name not reported")
+		if router.add(specific, "object"):
+			test.fail("Second client of a name reported as first")
+		if router.add(general, "object"):
+			test.fail("Client registered twice for the same name")
+		if general not in router or specific not in router:
+			test.fail("Registered clients not found")
+
+	def test_route(self, test):
+		router = EventRouter()
+		router.add(general, "object")
+		router.add(specific, "object:state-changed:focused")
+		clients = router.route(EventType.intern("object:state-changed:focused"))
+		test.assertEqual(clients, [general, specific],
+				 "Clients not routed most general first")
+		clients = router.route(EventType.intern("object:state-changed:showing"))
+		test.assertEqual(clients, [general], "Sibling event routed to specific client")
+		clients = router.route(EventType.intern("window:activate"))
+		test.assertEqual(clients, [], "Unrelated event routed")
+
+	def test_route_once(self, test):
+		router = EventRouter()
+		router.add(general, "object")
+		router.add(specific, "object:state-changed")
+		router.add(general, "object:state-changed:focused")
+		clients = router.route(EventType.intern("object:state-changed:focused"))
+		test.assertEqual(clients, [general, specific],
+				 "Client not routed once, at its most general registration")
+
+	def test_remove(self, test):
+		router = EventRouter()
+		router.add(general, "object:state-changed")
+		router.add(specific, "object:state-changed")
+		registered, released = router.remove(general, "object:state-changed")
+		if not registered or released:
+			test.fail("Name released while a client is left")
+		registered, released = router.remove(specific, "object:state-changed")
+		test.assertEqual(released, ["object:state-changed"], "Name not released")
+		registered, released = router.remove(specific, "object:state-changed")
+		if registered:
+			test.fail("Removed client still registered")
+		test.assertEqual(router.route(EventType.intern("object:state-changed:focused")),
+				 [], "Removed client still routed")
+
+	def test_remove_subevents(self, test):
+		router = EventRouter()
+		router.add(general, "object:state-changed:focused")
+		router.add(general, "object:bounds-changed")
+		registered, released = router.remove(general, "object")
+		if not registered:
+			test.fail("Client of subevents not reported as registered")
+		test.assertEqual(sorted(released),
+				 ["object:bounds-changed", "object:state-changed:focused"],
+				 "Subevent names not released")
+		if general in router:
+			test.fail("Client left in the trie")
+
+	def test_contains(self, test):
+		router = EventRouter()
+		router.add(general, "object:state-changed")
+		router.add(general, "window:activate")
+		router.remove(general, "window")
+		if general not in router:
+			test.fail("Client registered for another name not found")
+		router.remove(general, "object:state-changed:focused")
+		if general not in router:
+			test.fail("Client found by removing a subevent it was not registered for")
+		router.remove(general, "object:state-changed")
+		if general in router:
+			test.fail("Removed client still found")
+
+	def test_canonical(self, test):
+		test.assertEqual(EventRouter.canonical("object:state-changed:"),
+				 "object:state-changed", "Trailing separator kept")
+		test.assertEqual(EventRouter.canonical("window"), "window",
+				 "Single component changed")
+
+	def teardown(self, test):
+		pass
@@ -0,0 +1,97 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+import json
+import time
+
+from pasytest import PasyTest as _PasyTest
+
+import pyatspi
+from pyatspi.eventstats import LatencyHistogram
+
+from fixtures import FakeEvent, FakeNode
+
+def slow(event):
+	time.sleep(0.002)
+
+def fast(event):
+	pass
+
+class EventStatsTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_histogram",
+		     "test_registry",
+		     "test_disabled",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "EventStats", False)
+
+	def setup(self, test):
+		pass
+
+	def test_histogram(self, test):
+		histogram = LatencyHistogram()
+		for i in range(99):
+			histogram.record(100e-6)
+		histogram.record(10e-3)
+		test.assertEqual(histogram.count, 100, "Wrong count")
+		test.assertEqual(histogram.max, 10e-3, "Wrong maximum")
+		p50 = histogram.percentile(50)
+		if not 100e-6 <= p50 <= 100e-6 * (1 + 1.0 / LatencyHistogram.SUB_BUCKETS):
+			test.fail("Median outside the precision of its bucket: %f" % p50)
+		test.assertEqual(histogram.percentile(100), 10e-3, "Wrong top percentile")
+
+	def test_registry(self, test):
+		registry = pyatspi.Registry
+		registry.setStatsEnabled()
+		registry.registerEventListener(slow, "object:state-changed")
+		registry.registerEventListener(fast, "object:state-changed:focused")
+		try:
+			source = FakeNode("button")
+			for i in range(3):
+				registry._deliverEvent(FakeEvent("object:state-changed:focused", source, 1))
+			registry._deliverEvent(FakeEvent("object:state-changed:showing", source, 1))
+			stats = json.loads(registry.getStats().dump())
+		finally:
+			registry.deregisterEventListener(slow, "object:state-changed")
+			registry.deregisterEventListener(fast, "object:state-changed:focused")
+			registry.setStatsEnabled(False)
+		test.assertEqual(stats["events"]["object:state-changed:focused"]["count"], 3,
+				 "Arrivals not counted per type")
+		listeners = stats["listeners"]
+		test.assertEqual([listener["count"] for listener in listeners], [4, 3],
+				 "Calls not counted per listener, slowest first")
+		if not listeners[0]["name"].startswith("eventstatstest.slow@"):
+			test.fail("Listener not named: %s" % listeners[0]["name"])
+		if listeners[0]["total"] < 0.008:
+			test.fail("Listener time not measured")
+
+	def test_disabled(self, test):
+		registry = pyatspi.Registry
+		registry.setStatsEnabled(False)
+		registry.registerEventListener(fast, "window")
+		try:
+			registry._deliverEvent(FakeEvent("window:activate", FakeNode("frame")))
+		finally:
+			registry.deregisterEventListener(fast, "window")
+		test.assertEqual(registry.getStats(), None, "Statistics gathered while disabled")
+
+	def teardown(self, test):
+		pass
@@ -0,0 +1,68 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+from pasytest import PasyTest as _PasyTest
+
+from pyatspi.appevent import EventType
+
+class EventTypeTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_parse",
+		     "test_intern",
+		     "test_intern_bound",
+		     "test_attributes",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "EventType", False)
+
+	def setup(self, test):
+		pass
+
+	def test_parse(self, test):
+		event_type = EventType("object:state-changed:focused:")
+		test.assertEqual((event_type.klass, event_type.major, event_type.minor,
+				  event_type.detail),
+				 ("object", "state-changed", "focused", None),
+				 "Event type not parsed")
+		test.assertEqual(event_type, "object:state-changed:focused:",
+				 "Event type string changed")
+
+	def test_intern(self, test):
+		event_type = EventType.intern("object:text-changed:insert")
+		if EventType.intern("object:text-changed:insert") is not event_type:
+			test.fail("Event type parsed again")
+		test.assertEqual(event_type.minor, "insert", "Interned event type not parsed")
+		if EventType.intern("object:text-changed:delete") is event_type:
+			test.fail("Different names share an event type")
+
+	def test_intern_bound(self, test):
+		for i in range(EventType._INTERN_MAX + 1):
+			EventType.intern("object:bound-test:%d" % i)
+		if len(EventType._interned) > EventType._INTERN_MAX:
+			test.fail("Intern table not bounded")
+
+	def test_attributes(self, test):
+		# instances have always been plain structs
+		event_type = EventType("window:activate")
+		event_type.detail = "frame"
+		test.assertEqual(event_type.detail, "frame", "Attribute not set")
+
+	def teardown(self, test):
+		pass
@@ -0,0 +1,166 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+"""
+Local stand-ins for accessibles and events, for the tests which exercise
+pyatspi's own logic without an application on the bus.
+"""
+
+from gi.repository import GLib
+
+from pyatspi.appevent import EventType
+
+class FakeApplication(object):
+	def __init__(self, bus_name):
+		self.bus_name = bus_name
+
+class FakeNode(object):
+	"""
+	Stand-in for an accessible: iterating gives the children. Reading the
+	parent or the index in parent, which would be remote calls, is counted
+	in calls.
+	"""
+
+	def __init__(self, name, *children, **kwargs):
+		self.name = name
+		self.app = FakeApplication(kwargs.get("bus_name", ":1.42"))
+		self.path = kwargs.get("path", "/org/a11y/atspi/accessible/" + name)
+		self.children = list(children)
+		self._parent = None
+		self.calls = 0
+		for child in children:
+			child._parent = self
+
+	def _getParent(self):
+		self.calls += 1
+		return self._parent
+
+	def _setParent(self, parent):
+		self._parent = parent
+
+	parent = property(_getParent, _setParent)
+
+	def __iter__(self):
+		return iter(self.children)
+
+	def getIndexInParent(self):
+		self.calls += 1
+		return self._parent.children.index(self)
+
+	def find(self, name):
+		"""
+		@return: The node of that name in this subtree, or None
+		"""
+		if self.name == name:
+			return self
+		for child in self.children:
+			found = child.find(name)
+			if found is not None:
+				return found
+		return None
+
+def fakeTree():
+	"""
+	Builds this tree and returns its root:
+
+	        root
+	       /    \\
+	      a      b
+	     / \\      \\
+	    a1  a2     b1
+	    |
+	   a11
+	"""
+	return FakeNode("root",
+			FakeNode("a", FakeNode("a1", FakeNode("a11")), FakeNode("a2")),
+			FakeNode("b", FakeNode("b1")))
+
+class FakeEvent(object):
+	"""
+	Stand-in for an Atspi.Event.
+	"""
+
+	def __init__(self, name, source=None, detail1=0, detail2=0, any_data=None):
+		self.type = EventType.intern(name)
+		self.source = source
+		self.detail1 = detail1
+		self.detail2 = detail2
+		self.any_data = any_data
+
+class FakeRegistry(object):
+	"""
+	Registry delivering the events sent to it, which can be told to have
+	dropped some.
+	"""
+
+	def __init__(self):
+		self.dropped = 0
+		self.clients = []
+
+	def getDroppedCount(self):
+		return self.dropped
+
+	def registerEventListener(self, client, *names, **kwargs):
+		self.clients.append(client)
+
+	def deregisterEventListener(self, client, *names):
+		self.clients.remove(client)
+
+	def send(self, name, source, detail1=0, detail2=0, any_data=None):
+		for client in self.clients:
+			client(FakeEvent(name, source, detail1, detail2, any_data))
+
+class FakeConnection(object):
+	"""
+	Stand-in for a Gio connection to the accessibility bus: each call is
+	answered from replies, keyed on (path, interface, method), from the
+	thread-default context of the caller as Gio does. A reply which is an
+	exception is raised by call_finish.
+	"""
+
+	def __init__(self, replies):
+		self.replies = replies
+		self.calls = []
+		self.in_flight = 0
+		self.most_in_flight = 0
+
+	def call(self, bus_name, path, interface, method, args, reply_type, flags,
+		 timeout, cancellable, callback, user_data):
+		self.calls.append((path, interface, method, args.unpack() if args else None))
+		self.in_flight += 1
+		self.most_in_flight = max(self.most_in_flight, self.in_flight)
+		source = GLib.Idle()
+		source.set_callback(self._reply, (callback, (path, interface, method), user_data))
+		source.attach(GLib.MainContext.ref_thread_default())
+
+	def _reply(self, data):
+		callback, key, user_data = data
+		self.in_flight -= 1
+		callback(self, key, user_data)
+		return False
+
+	def call_finish(self, key):
+		reply = self.replies[key]
+		if isinstance(reply, Exception):
+			raise reply
+		return reply
+
+	def close_sync(self, cancellable):
+		pass
+
+def names(nodes):
+	return [node.name for node in nodes]
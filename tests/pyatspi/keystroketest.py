@@ -0,0 +1,96 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+from gi.repository import Atspi
+
+from pasytest import PasyTest as _PasyTest
+
+import pyatspi
+
+def client(event):
+	return False
+
+class KeystrokeTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_masks",
+		     "test_repeat",
+		     "test_flags_replaced",
+		     "test_deregister_all",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "Keystroke", False)
+
+	def setup(self, test):
+		# record the calls to the device event controller instead of making them
+		self.calls = []
+		self._register = Atspi.register_keystroke_listener
+		self._deregister = Atspi.deregister_keystroke_listener
+		def register(listener, key_set, mask, kind, flags):
+			self.calls.append(("register", mask, int(flags)))
+			return True
+		def deregister(listener, key_set, mask, kind):
+			self.calls.append(("deregister", mask))
+			return True
+		Atspi.register_keystroke_listener = register
+		Atspi.deregister_keystroke_listener = deregister
+
+	def test_masks(self, test):
+		registry = pyatspi.Registry
+		self.calls = []
+		registry.registerKeystrokeListener(client, mask=[0, 1, 1, 4])
+		test.assertEqual([call[1] for call in self.calls], [0, 1, 4],
+				 "Masks not registered once each")
+		registry.deregisterKeystrokeListeners(client)
+
+	def test_repeat(self, test):
+		registry = pyatspi.Registry
+		registry.registerKeystrokeListener(client, mask=[0, 1])
+		self.calls = []
+		registry.registerKeystrokeListener(client, mask=[0, 1])
+		test.assertEqual(self.calls, [], "Registration in place repeated")
+		registry.deregisterKeystrokeListeners(client)
+
+	def test_flags_replaced(self, test):
+		registry = pyatspi.Registry
+		registry.registerKeystrokeListener(client, mask=0, synchronous=True)
+		self.calls = []
+		registry.registerKeystrokeListener(client, mask=0, synchronous=False)
+		flags = int(registry.makeSyncType(False, True, False))
+		test.assertEqual(self.calls, [("deregister", 0), ("register", 0, flags)],
+				 "New flags not replacing the registration")
+		self.calls = []
+		test.assertEqual(registry.deregisterKeystrokeListeners(client), 1,
+				 "Registration with new flags kept twice")
+
+	def test_deregister_all(self, test):
+		registry = pyatspi.Registry
+		registry.registerKeystrokeListener(client, key_set=[38], mask=[0, 1])
+		registry.registerKeystrokeListener(client, key_set=[39], mask=0)
+		self.calls = []
+		test.assertEqual(registry.deregisterKeystrokeListeners(client), 3,
+				 "Wrong number of registrations removed")
+		test.assertEqual(sorted(call[1] for call in self.calls), [0, 0, 1],
+				 "Registrations not removed")
+		if client in registry.event_listeners:
+			test.fail("Device listener kept for a removed client")
+
+	def teardown(self, test):
+		Atspi.register_keystroke_listener = self._register
+		Atspi.deregister_keystroke_listener = self._deregister
@@ -0,0 +1,196 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+from pasytest import PasyTest as _PasyTest
+
+import pyatspi
+from pyatspi import Match, findAllDescendants, findDescendant
+
+from fixtures import FakeNode, names
+
+class _StateSet(object):
+	def __init__(self, states):
+		self.states = states
+
+	def contains(self, state):
+		return state in self.states
+
+class _Node(FakeNode):
+	"""
+	Node exposing what a Match evaluates locally.
+	"""
+
+	def __init__(self, name, role, *children, **kwargs):
+		FakeNode.__init__(self, name, *children)
+		self.role = role
+		self.states = kwargs.get("states", ())
+		self.attributes = kwargs.get("attributes", {})
+		self.interfaces = kwargs.get("interfaces", ["Accessible"])
+
+	def getRole(self):
+		return self.role
+
+	def getState(self):
+		return _StateSet(self.states)
+
+	def getAttributes(self):
+		return ["%s:%s" % item for item in self.attributes.items()]
+
+	def get_interfaces(self):
+		return self.interfaces
+
+class _Collection(object):
+	"""
+	Collection answering getMatches with the matches of the predicate.
+	"""
+
+	def __init__(self, root):
+		self.root = root
+		self.calls = []
+
+	def createMatchRule(self, *args):
+		return args
+
+	def getMatches(self, rule, sortby, count, traverse):
+		self.calls.append(count)
+		matches = findAllDescendants(self.root, self.root.pred, max_nodes=1000)
+		return matches[:count] if count else matches
+
+class _Root(_Node):
+	def __init__(self, pred, *children):
+		_Node.__init__(self, "root", pyatspi.ROLE_FRAME, *children)
+		self.pred = pred
+		self.collection = _Collection(self)
+
+	def queryCollection(self):
+		return self.collection
+
+def _tree(pred=None):
+	#        root
+	#       /    \
+	#    ok      cancel
+	#     |
+	#   label
+	return _Root(pred,
+		     _Node("ok", pyatspi.ROLE_PUSH_BUTTON,
+			   _Node("label", pyatspi.ROLE_LABEL),
+			   states=(pyatspi.STATE_SHOWING,),
+			   attributes={"toolkit": "gtk"},
+			   interfaces=["Accessible", "Action"]),
+		     _Node("cancel", pyatspi.ROLE_PUSH_BUTTON))
+
+class MatchTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_predicate",
+		     "test_remote",
+		     "test_remote_first",
+		     "test_name",
+		     "test_limited",
+		     "test_no_collection",
+		     "test_rule_variant",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "Match", False)
+
+	def setup(self, test):
+		pass
+
+	def test_predicate(self, test):
+		root = _tree()
+		ok = root.find("ok")
+		cancel = root.find("cancel")
+		test.assertEqual(Match(roles=[pyatspi.ROLE_PUSH_BUTTON])(cancel), True,
+				 "Role not matched")
+		test.assertEqual(Match(roles=[pyatspi.ROLE_LABEL])(cancel), False,
+				 "Wrong role matched")
+		test.assertEqual(Match(states=[pyatspi.STATE_SHOWING])(ok), True,
+				 "States not matched")
+		test.assertEqual(Match(states=[pyatspi.STATE_SHOWING])(cancel), False,
+				 "Missing state matched")
+		test.assertEqual(Match(attributes={"toolkit": "gtk"})(ok), True,
+				 "Attributes not matched")
+		test.assertEqual(Match(attributes={"toolkit": "qt"})(ok), False,
+				 "Wrong attribute matched")
+		test.assertEqual(Match(interfaces=["Action"])(ok), True,
+				 "Interfaces not matched")
+		test.assertEqual(Match(interfaces=["Action"])(cancel), False,
+				 "Missing interface matched")
+		test.assertEqual(Match(name="^can")(cancel), True, "Name not matched")
+
+	def test_remote(self, test):
+		match = Match(roles=[pyatspi.ROLE_PUSH_BUTTON])
+		root = _tree(match)
+		test.assertEqual(names(findAllDescendants(root, match)), ["ok", "cancel"],
+				 "Wrong matches")
+		test.assertEqual(root.collection.calls, [0], "Search not done by Collection")
+
+	def test_remote_first(self, test):
+		match = Match(roles=[pyatspi.ROLE_PUSH_BUTTON])
+		root = _tree(match)
+		test.assertEqual(findDescendant(root, match).name, "ok", "Wrong match")
+		test.assertEqual(root.collection.calls, [1], "Search not limited to one match")
+
+	def test_name(self, test):
+		match = Match(roles=[pyatspi.ROLE_PUSH_BUTTON], name="^can")
+		root = _tree(Match(roles=[pyatspi.ROLE_PUSH_BUTTON]))
+		test.assertEqual(findDescendant(root, match).name, "cancel",
+				 "Name not checked on the matches")
+		# the limit applies after the name is checked
+		test.assertEqual(root.collection.calls, [0], "Matches limited before the name")
+
+	def test_limited(self, test):
+		match = Match(roles=[pyatspi.ROLE_LABEL])
+		root = _tree(match)
+		test.assertEqual(names(findAllDescendants(root, match, max_depth=1)), [],
+				 "Match found below max_depth")
+		test.assertEqual(names(findAllDescendants(root, match, max_depth=2)), ["label"],
+				 "Match not found node by node")
+		test.assertEqual(root.collection.calls, [], "Limited search done by Collection")
+
+	def test_no_collection(self, test):
+		match = Match(roles=[pyatspi.ROLE_PUSH_BUTTON])
+		root = _tree(match)
+
+		def missing():
+			raise NotImplementedError
+		root.queryCollection = missing
+		test.assertEqual(names(findAllDescendants(root, match)), ["ok", "cancel"],
+				 "No node by node search without Collection")
+
+	def test_rule_variant(self, test):
+		match = Match(roles=[pyatspi.ROLE_PUSH_BUTTON], attributes={"toolkit": "gtk"})
+		rule = match._ruleVariant()
+		test.assertEqual(rule.get_type_string(), "(aiia{ss}iaiiasib)",
+				 "Wrong rule signature")
+		(states, state_match, attributes, attribute_match, roles, role_match,
+		 interfaces, interface_match, invert) = rule.unpack()
+		role = int(pyatspi.ROLE_PUSH_BUTTON)
+		expected = [0] * 4
+		expected[role // 32] = 1 << (role % 32)
+		test.assertEqual(roles, expected, "Wrong role bits")
+		test.assertEqual(role_match, int(pyatspi.Collection.MATCH_ANY),
+				 "Wrong role match type")
+		test.assertEqual(states, [0, 0], "State bits without states")
+		test.assertEqual(state_match, int(pyatspi.Collection.MATCH_NONE),
+				 "Empty states constrain the match")
+		test.assertEqual(attributes, {"toolkit": "gtk"}, "Wrong attributes")
+
+	def teardown(self, test):
+		pass
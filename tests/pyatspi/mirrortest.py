@@ -0,0 +1,172 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+import threading
+
+from pasytest import PasyTest as _PasyTest
+
+import pyatspi
+from pyatspi import TreeMirror
+
+from fixtures import FakeNode, FakeRegistry
+
+SHOWING = int(pyatspi.STATE_SHOWING)
+
+class _StateSet(object):
+	def __init__(self, states):
+		self.states = states
+
+class _Node(FakeNode):
+	"""
+	Node counting the fields read from it.
+	"""
+
+	fetches = 0
+
+	def __init__(self, name, *children):
+		FakeNode.__init__(self, name, *children)
+		self.role = pyatspi.ROLE_PANEL
+		self.states = 0
+
+	def getRole(self):
+		_Node.fetches += 1
+		return self.role
+
+	def getState(self):
+		_Node.fetches += 1
+		return _StateSet(self.states)
+
+	def __iter__(self):
+		_Node.fetches += 1
+		return iter(list(self.children))
+
+def _tree():
+	return _Node("root",
+		     _Node("a", _Node("a1", _Node("a11")), _Node("a2")),
+		     _Node("b", _Node("b1")))
+
+class MirrorTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_load",
+		     "test_fields",
+		     "test_add",
+		     "test_remove",
+		     "test_resync",
+		     "test_threads",
+		     "test_close",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "Mirror", False)
+
+	def setup(self, test):
+		pass
+
+	def _mirror(self):
+		self.root = _tree()
+		self.registry = FakeRegistry()
+		return TreeMirror(self.root, registry=self.registry)
+
+	def test_load(self, test):
+		mirror = self._mirror()
+		test.assertEqual(len(mirror), 7, "Wrong node count")
+		a1 = mirror.getNode(self.root.find("a1"))
+		test.assertEqual((a1.name, a1.parent.name), ("a1", "a"), "Wrong node")
+		test.assertEqual(mirror.check(), [], "Mirror differs from the tree")
+
+	def test_fields(self, test):
+		mirror = self._mirror()
+		b = self.root.find("b")
+		_Node.fetches = 0
+		b.states |= 1 << SHOWING
+		self.registry.send("object:state-changed:showing", b, 1)
+		b.name = "renamed"
+		self.registry.send("object:property-change:accessible-name", b, any_data="renamed")
+		node = mirror.getNode(b)
+		test.assertEqual(node.hasState(pyatspi.STATE_SHOWING), True, "State not applied")
+		test.assertEqual(node.name, "renamed", "Name not applied")
+		test.assertEqual(_Node.fetches, 0, "Fields fetched for events carrying them")
+		test.assertEqual(mirror.events, 2, "Events not counted")
+		test.assertEqual(mirror.check(), [], "Mirror differs from the tree")
+
+	def test_add(self, test):
+		mirror = self._mirror()
+		a = self.root.find("a")
+		child = _Node("a3", _Node("a31"))
+		a.children.append(child)
+		child.parent = a
+		_Node.fetches = 0
+		self.registry.send("object:children-changed:add", a, 2, any_data=child)
+		test.assertEqual(_Node.fetches, 0, "Added subtree walked in the event callback")
+		test.assertEqual(mirror.getNode(child), None, "Added child mirrored before refresh")
+		test.assertEqual(mirror.refresh(), 1, "Parent of the added child not refreshed")
+		test.assertEqual([node.name for node in mirror.getNode(child).children], ["a31"],
+				 "Added subtree not walked")
+		test.assertEqual(mirror.check(), [], "Mirror differs from the tree")
+
+	def test_remove(self, test):
+		mirror = self._mirror()
+		a = self.root.find("a")
+		a1 = a.children.pop(0)
+		self.registry.send("object:children-changed:remove", a, 0, any_data=a1)
+		test.assertEqual(mirror.getNode(a1.children[0]), None, "Removed subtree kept")
+		test.assertEqual(len(mirror), 5, "Wrong node count")
+		test.assertEqual(mirror.refresh(), 0, "Refresh after an applied removal")
+		test.assertEqual(mirror.check(), [], "Mirror differs from the tree")
+
+	def test_resync(self, test):
+		mirror = self._mirror()
+		b = self.root.find("b")
+		# the removal of b1 and the events after it are lost
+		b.children.pop(0)
+		self.registry.dropped += 1
+		b.name = "renamed"
+		self.registry.send("object:property-change:accessible-name", b, any_data="renamed")
+		test.assertEqual(mirror.getNode(b).name, "b", "Event applied after a loss")
+		test.assertEqual(mirror.refresh(), 6, "Subtree not walked again")
+		test.assertEqual(mirror.getNode(b).name, "renamed", "Not resynchronized")
+		test.assertEqual(mirror.check(), [], "Mirror differs from the tree")
+
+	def test_threads(self, test):
+		mirror = self._mirror()
+		a = self.root.find("a")
+		nodes = [self.root.find(name) for name in ("a", "a1", "a2", "b", "b1")]
+
+		def send():
+			for i in range(2000):
+				node = nodes[i % len(nodes)]
+				node.states ^= 1 << SHOWING
+				self.registry.send("object:state-changed:showing", node,
+						   node.states >> SHOWING & 1)
+				if i % 100 == 0:
+					self.registry.send("object:children-changed:add", a, 0)
+		thread = threading.Thread(target=send)
+		thread.start()
+		while thread.is_alive():
+			mirror.refresh()
+		thread.join()
+		test.assertEqual(mirror.check(), [], "Mirror differs from the tree")
+
+	def test_close(self, test):
+		mirror = self._mirror()
+		mirror.close()
+		test.assertEqual(self.registry.clients, [], "Still following events")
+
+	def teardown(self, test):
+		pass
@@ -0,0 +1,148 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+import time
+
+from gi.repository import Gio
+from gi.repository import GLib
+
+from pasytest import PasyTest as _PasyTest
+
+import pyatspi
+import pyatspi.utils
+from pyatspi import AccessibleReference, Match, findAllDescendantsParallel
+
+from fixtures import FakeConnection, FakeNode
+
+COLLECTION = "org.a11y.atspi.Collection"
+PROPERTIES = "org.freedesktop.DBus.Properties"
+
+class _Node(FakeNode):
+	def __init__(self, name, role, *children, **kwargs):
+		FakeNode.__init__(self, name, *children, **kwargs)
+		self.role = role
+
+	def getRole(self):
+		return self.role
+
+def _application(name, *children):
+	return _Node(name, pyatspi.ROLE_APPLICATION, *children, bus_name=":1." + name)
+
+def _refs(bus_name, *paths):
+	return GLib.Variant("(a(so))", ([(bus_name, path) for path in paths],))
+
+def _error(code, message):
+	return GLib.Error.new_literal(Gio.io_error_quark(), message, code)
+
+class ParallelSearchTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_references",
+		     "test_name",
+		     "test_timed_out",
+		     "test_no_collection",
+		     "test_fallback_timeout",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "ParallelSearch", False)
+
+	def setup(self, test):
+		self.saved_bus = pyatspi.utils._search_bus
+
+	def _install(self):
+		# three applications: one with buttons, one hung and one without
+		# Collection, whose buttons have to be found node by node
+		self.desktop = _Node("desktop", pyatspi.ROLE_DESKTOP_FRAME,
+				     _application("1"), _application("2"),
+				     _application("3", _Node("ok", pyatspi.ROLE_PUSH_BUTTON,
+							     bus_name=":1.3")))
+		self.apps = self.desktop.children
+		self.replies = {
+			(self.apps[0].path, COLLECTION, "GetMatches"):
+				_refs(":1.1", "/button/ok", "/button/cancel"),
+			(self.apps[1].path, COLLECTION, "GetMatches"):
+				_error(Gio.IOErrorEnum.TIMED_OUT, "Timeout was reached"),
+			(self.apps[2].path, COLLECTION, "GetMatches"):
+				GLib.Error("org.freedesktop.DBus.Error.UnknownMethod"),
+			("/button/ok", PROPERTIES, "Get"):
+				GLib.Variant("(v)", (GLib.Variant("s", "OK"),)),
+			("/button/cancel", PROPERTIES, "Get"):
+				GLib.Variant("(v)", (GLib.Variant("s", "Cancel"),)),
+		}
+		self.connection = FakeConnection(self.replies)
+		pyatspi.utils._search_bus = self.connection
+
+	def _search(self, match, **kwargs):
+		timed_out = []
+		matches = findAllDescendantsParallel(self.desktop, match, timed_out=timed_out,
+						     **kwargs)
+		return matches, timed_out
+
+	def test_references(self, test):
+		self._install()
+		matches, timed_out = self._search(Match(roles=[pyatspi.ROLE_PUSH_BUTTON]),
+						  workers=2)
+		test.assertEqual(matches[:2], [AccessibleReference(":1.1", "/button/ok"),
+					      AccessibleReference(":1.1", "/button/cancel")],
+				 "Matches not built from the references")
+		test.assertEqual([match.name for match in matches[2:]], ["ok"],
+				 "Application without Collection not searched")
+		test.assertEqual(timed_out, [self.apps[1]], "Hung application not reported")
+		test.assertEqual([call[2] for call in self.connection.calls],
+				 ["GetMatches"] * 3, "Matches searched again")
+		test.assertEqual(self.connection.most_in_flight, 2, "Searches not in flight at once")
+
+	def test_name(self, test):
+		self._install()
+		matches, timed_out = self._search(Match(roles=[pyatspi.ROLE_PUSH_BUTTON],
+							name="^OK"))
+		test.assertEqual(matches[:1], [AccessibleReference(":1.1", "/button/ok")],
+				 "Name not checked on the references")
+		test.assertEqual(len(matches), 1, "Name not checked node by node")
+
+	def test_timed_out(self, test):
+		self._install()
+		self.replies[("/button/cancel", PROPERTIES, "Get")] = \
+			_error(Gio.IOErrorEnum.TIMED_OUT, "Timeout was reached")
+		matches, timed_out = self._search(Match(roles=[pyatspi.ROLE_PUSH_BUTTON],
+							name="."), timeout=1)
+		test.assertEqual(timed_out, self.apps[:2], "Name read timeout not reported")
+
+	def test_no_collection(self, test):
+		self._install()
+		pyatspi.utils._search_bus = False
+		matches, timed_out = self._search(Match(roles=[pyatspi.ROLE_PUSH_BUTTON]))
+		test.assertEqual([match.name for match in matches], ["ok"],
+				 "No node by node search without a bus")
+		test.assertEqual(self.connection.calls, [], "Bus used when unavailable")
+
+	def test_fallback_timeout(self, test):
+		self._install()
+		def slow(node):
+			time.sleep(0.02)
+			return node.getRole() == pyatspi.ROLE_PUSH_BUTTON
+		matches, timed_out = self._search(slow, timeout=0.01)
+		test.assertEqual(matches, [], "Subtree searched past the timeout")
+		test.assertEqual(timed_out, self.apps, "Timed out subtrees not reported")
+		matches, timed_out = self._search(slow)
+		test.assertEqual([match.name for match in matches], ["ok"],
+				 "Wrong node by node matches")
+
+	def teardown(self, test):
+		pyatspi.utils._search_bus = self.saved_bus
@@ -0,0 +1,116 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+from pasytest import PasyTest as _PasyTest
+
+from pyatspi.parentcache import ParentCache
+
+from fixtures import FakeEvent, FakeNode, FakeRegistry
+
+def _tree():
+	root = FakeNode("root", FakeNode("child", FakeNode("first"), FakeNode("leaf")))
+	return root, root.find("child"), root.find("leaf")
+
+class ParentCacheTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_lookup",
+		     "test_index",
+		     "test_children_changed",
+		     "test_parent_changed",
+		     "test_dropped_events",
+		     "test_clear",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "ParentCache", False)
+
+	def setup(self, test):
+		pass
+
+	def test_lookup(self, test):
+		root, child, leaf = _tree()
+		cache = ParentCache()
+		hits = cache.counter.hits
+		test.assertEqual(cache.lookup(leaf), (child, None), "Wrong parent")
+		test.assertEqual(cache.lookup(leaf), (child, None), "Wrong cached parent")
+		test.assertEqual(leaf.calls, 1, "Cached parent fetched again")
+		test.assertEqual(cache.counter.hits - hits, 1, "Hit not counted")
+		test.assertEqual(cache.lookup(root), (None, None), "Wrong parent of the top")
+		test.assertEqual(len(cache), 2, "Wrong number of entries")
+
+	def test_index(self, test):
+		root, child, leaf = _tree()
+		cache = ParentCache()
+		cache.lookup(leaf)
+		# the index was not fetched by the first lookup
+		test.assertEqual(cache.lookup(leaf, True), (child, 1), "Wrong index")
+		test.assertEqual(cache.lookup(leaf, True), (child, 1), "Wrong cached index")
+		test.assertEqual(leaf.calls, 2, "Cached parent or index fetched again")
+
+	def test_children_changed(self, test):
+		root, child, leaf = _tree()
+		cache = ParentCache()
+		cache.lookup(leaf, True)
+		cache.lookup(child, True)
+		cache._onEvent(FakeEvent("object:children-changed:add", child))
+		test.assertEqual(len(cache), 1, "Children of the source not forgotten")
+		cache._onEvent(FakeEvent("object:children-changed:remove", root, any_data=child))
+		test.assertEqual(len(cache), 0, "Removed child not forgotten")
+		calls = leaf.calls
+		cache.lookup(leaf, True)
+		test.assertEqual(leaf.calls - calls, 2, "Forgotten entry not fetched again")
+
+	def test_parent_changed(self, test):
+		root, child, leaf = _tree()
+		cache = ParentCache()
+		cache.lookup(leaf)
+		cache.lookup(child)
+		cache._onEvent(FakeEvent("object:property-change:accessible-parent", leaf))
+		test.assertEqual(len(cache), 1, "Source not forgotten")
+		leaf.parent = root
+		test.assertEqual(cache.lookup(leaf), (root, None), "New parent not fetched")
+
+	def test_dropped_events(self, test):
+		root, child, leaf = _tree()
+		registry = FakeRegistry()
+		cache = ParentCache(registry)
+		cache.lookup(leaf)
+		cache.lookup(child)
+		evictions = cache.counter.evictions
+		registry.dropped += 1
+		leaf.parent = root
+		test.assertEqual(cache.lookup(leaf), (root, None),
+				 "Stale parent returned after dropped events")
+		test.assertEqual(len(cache), 1, "Cache not emptied after dropped events")
+		test.assertEqual(cache.counter.evictions - evictions, 2,
+				 "Emptied entries not counted as evictions")
+		calls = child.calls
+		cache.lookup(child)
+		test.assertEqual(child.calls - calls, 1, "Emptied entry not fetched again")
+
+	def test_clear(self, test):
+		root, child, leaf = _tree()
+		cache = ParentCache()
+		cache.lookup(leaf)
+		cache.lookup(child)
+		test.assertEqual(cache.clear(), 2, "Wrong number of entries dropped")
+		test.assertEqual(len(cache), 0, "Cache not emptied")
+
+	def teardown(self, test):
+		pass
@@ -0,0 +1,116 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+from gi.repository import GLib
+
+from pasytest import PasyTest as _PasyTest
+
+from pyatspi.pipeline import Pipeline, COMPONENT, TEXT, PROPERTIES
+
+from fixtures import FakeConnection, FakeNode
+
+class _Text(object):
+	def getText(self, start, end):
+		return "local"[start:end if end >= 0 else None]
+
+class _TextNode(FakeNode):
+	def queryText(self):
+		return _Text()
+
+class PipelineTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_extents",
+		     "test_text",
+		     "test_overlap",
+		     "test_failed",
+		     "test_local",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "Pipeline", False)
+
+	def setup(self, test):
+		self.nodes = [FakeNode("node%d" % i) for i in range(4)]
+		self.replies = {}
+		for node in self.nodes:
+			self.replies[(node.path, COMPONENT, "GetExtents")] = \
+				GLib.Variant("((iiii))", ((1, 2, 30, 40),))
+			self.replies[(node.path, TEXT, "GetText")] = \
+				GLib.Variant("(s)", (node.name,))
+			self.replies[(node.path, PROPERTIES, "Get")] = \
+				GLib.Variant("(v)", (GLib.Variant("s", node.name),))
+
+	def _pipeline(self, depth=64):
+		pipeline = Pipeline(depth)
+		pipeline._connection = FakeConnection(self.replies)
+		return pipeline
+
+	def test_extents(self, test):
+		pipeline = self._pipeline()
+		future = pipeline.submit(self.nodes[0], ("getExtents", 1))
+		pipeline.wait((future,))
+		extents = future.result()
+		test.assertEqual(list(extents), [1, 2, 30, 40], "Wrong extents")
+		test.assertEqual(extents.width, 30, "Extents are not a bounding box")
+		test.assertEqual(pipeline._connection.calls,
+				 [(self.nodes[0].path, COMPONENT, "GetExtents", (1,))],
+				 "Wrong call for the extents")
+
+	def test_text(self, test):
+		pipeline = self._pipeline()
+		test.assertEqual(pipeline.get(self.nodes[1], ("getText", 0, -1)), "node1",
+				 "Wrong text")
+		test.assertEqual(pipeline._connection.calls,
+				 [(self.nodes[1].path, TEXT, "GetText", (0, -1))],
+				 "Wrong call for the text")
+
+	def test_overlap(self, test):
+		pipeline = self._pipeline(depth=3)
+		done = []
+		futures = []
+		for node in self.nodes:
+			futures.append(pipeline.submit(node, "name", done.append))
+			futures.append(pipeline.submit(node, ("getExtents", 0), done.append))
+			futures.append(pipeline.submit(node, ("getText", 0, -1), done.append))
+		test.assertEqual(pipeline._connection.in_flight, 3, "Calls not kept in flight")
+		pipeline.wait(futures)
+		test.assertEqual(pipeline._connection.most_in_flight, 3, "Depth not respected")
+		test.assertEqual(len(done), len(futures), "Callbacks not called")
+		test.assertEqual([future.result() for future in futures[0::3]],
+				 [node.name for node in self.nodes], "Wrong names")
+		test.assertEqual([future.result() for future in futures[2::3]],
+				 [node.name for node in self.nodes], "Wrong texts")
+
+	def test_failed(self, test):
+		pipeline = self._pipeline()
+		self.replies[(self.nodes[2].path, TEXT, "GetText")] = \
+			GLib.Error("org.freedesktop.DBus.Error.UnknownObject")
+		values = pipeline.fetch(self.nodes, ("getText", 0, -1), default="gone")
+		test.assertEqual([value for value, in values],
+				 ["node0", "node1", "gone", "node3"], "Failed call not defaulted")
+
+	def test_local(self, test):
+		pipeline = Pipeline()
+		# no bus of its own: read through the interface
+		pipeline._connection = False
+		test.assertEqual(pipeline.get(_TextNode("node"), ("getText", 0, 3)), "loc",
+				 "Text not read through the interface")
+
+	def teardown(self, test):
+		pass
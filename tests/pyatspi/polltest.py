@@ -0,0 +1,122 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+import os
+import select
+import threading
+
+from gi.repository import GLib
+
+from pasytest import PasyTest as _PasyTest
+
+import pyatspi
+from pyatspi.registry import _WakeupPoller
+
+from fixtures import FakeEvent, FakeNode
+
+class _Connection(object):
+	"""
+	Pipe watched by the main context, standing for the bus connection:
+	each byte written is read as one event.
+	"""
+
+	def __init__(self, registry):
+		self.registry = registry
+		self.source = FakeNode("frame")
+		self._read_fd, self._write_fd = os.pipe()
+		self._watch = GLib.io_add_watch(self._read_fd, GLib.PRIORITY_DEFAULT,
+						GLib.IOCondition.IN, self._readable)
+
+	def send(self):
+		os.write(self._write_fd, b"x")
+
+	def _readable(self, fd, condition):
+		os.read(fd, 1)
+		self.registry._receiveEvent(FakeEvent("window:activate", self.source))
+		return True
+
+	def close(self):
+		GLib.source_remove(self._watch)
+		os.close(self._read_fd)
+		os.close(self._write_fd)
+
+def _readable(fd, timeout):
+	return bool(select.select([fd], [], [], timeout)[0])
+
+class PollTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_poll",
+		     "test_fallback",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "Poll", False)
+
+	def setup(self, test):
+		self.received = []
+		pyatspi.Registry.registerEventListener(self.received.append, "window")
+
+	def test_poll(self, test):
+		registry = pyatspi.Registry
+		connection = _Connection(registry)
+		fd = registry.getPollFd()
+		try:
+			registry.dispatchPending()
+			if _readable(fd, 0):
+				test.fail("Descriptor readable without traffic")
+			connection.send()
+			if not _readable(fd, 1):
+				test.fail("Descriptor not readable for traffic")
+			registry.dispatchPending()
+			test.assertEqual(len(self.received), 1, "Event not dispatched")
+			if _readable(fd, 0):
+				test.fail("Descriptor still readable after dispatch")
+		finally:
+			registry.closePollFd()
+			connection.close()
+
+	def test_fallback(self, test):
+		registry = pyatspi.Registry
+		epoll = select.epoll
+		# as on systems without epoll
+		del select.epoll
+		try:
+			fd = registry.getPollFd()
+		finally:
+			select.epoll = epoll
+		try:
+			if not isinstance(registry._poller, _WakeupPoller):
+				test.fail("No fallback without epoll")
+			registry.dispatchPending()
+			test.assertEqual(registry.getPollTimeout(), _WakeupPoller.INTERVAL,
+					 "No dispatch interval without traffic")
+			called = []
+			thread = threading.Thread(target=registry.callFromThread,
+						  args=(called.append, "called"))
+			thread.start()
+			thread.join()
+			if not _readable(fd, 1):
+				test.fail("Descriptor not readable for a call from a thread")
+			registry.dispatchPending()
+			test.assertEqual(called, ["called"], "Call from a thread not run")
+		finally:
+			registry.closePollFd()
+
+	def teardown(self, test):
+		pyatspi.Registry.deregisterEventListener(self.received.append, "window")
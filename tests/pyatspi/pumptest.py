@@ -0,0 +1,97 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+from gi.repository import GLib
+
+from pasytest import PasyTest as _PasyTest
+
+import pyatspi
+
+from fixtures import FakeEvent, FakeNode
+
+class _Sender(object):
+	"""
+	Main loop source delivering one event per iteration, the way libatspi
+	dispatches the messages it reads from the bus.
+	"""
+
+	def __init__(self, registry, count):
+		self.registry = registry
+		self.left = count
+		self.source = FakeNode("frame")
+		GLib.idle_add(self._send)
+
+	def _send(self):
+		self.registry._receiveEvent(FakeEvent("window:activate", self.source))
+		self.left -= 1
+		return self.left > 0
+
+class PumpTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_none_count",
+		     "test_none_all",
+		     "test_none_timeout",
+		     "test_pumped",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "Pump", False)
+
+	def setup(self, test):
+		self.received = []
+
+	def _use(self, main_loop):
+		pyatspi.set_default_registry(main_loop)
+		registry = pyatspi.Registry
+		self.received = []
+		registry.registerEventListener(self.received.append, "window")
+		return registry
+
+	def test_none_count(self, test):
+		registry = self._use(pyatspi.MAIN_LOOP_NONE)
+		sender = _Sender(registry, 10)
+		test.assertEqual(registry.pumpQueuedEvents(3), 3, "Count not respected")
+		test.assertEqual(len(self.received), 3, "Events not dispatched")
+		test.assertEqual(sender.left, 7, "Events read past the count")
+		registry.pumpQueuedEvents()
+
+	def test_none_all(self, test):
+		registry = self._use(pyatspi.MAIN_LOOP_NONE)
+		_Sender(registry, 10)
+		test.assertEqual(registry.pumpQueuedEvents(), 10, "Pending events not dispatched")
+		test.assertEqual(registry.pumpQueuedEvents(), 0, "Events dispatched twice")
+
+	def test_none_timeout(self, test):
+		registry = self._use(pyatspi.MAIN_LOOP_NONE)
+		sender = _Sender(registry, 10)
+		test.assertEqual(registry.pumpQueuedEvents(timeout=0), 0,
+				 "Events dispatched without time")
+		registry.pumpQueuedEvents()
+		test.assertEqual(sender.left, 0, "Events left")
+
+	def test_pumped(self, test):
+		registry = self._use(pyatspi.MAIN_LOOP_PUMPED)
+		_Sender(registry, 10)
+		test.assertEqual(registry.pumpQueuedEvents(4), 6, "Wrong number of events left")
+		test.assertEqual(len(self.received), 4, "Count not respected")
+		test.assertEqual(registry.pumpQueuedEvents(), 0, "Events left")
+		test.assertEqual(len(self.received), 10, "Events lost")
+
+	def teardown(self, test):
+		pyatspi.set_default_registry(pyatspi.MAIN_LOOP_GLIB)
@@ -22,4 +22,25 @@ run libaccessibleapp.so collectiontest AccessibleTest
 run libcomponentapp.so componenttest ComponentTest
 run librelationapp.so relationtest RelationTest
 run libaccessibleapp.so statetest StateTest
+run libaccessibleapp.so eventroutertest EventRouterTest
+run libaccessibleapp.so dispatchtest DispatchTest
+run libaccessibleapp.so eventtypetest EventTypeTest
+run libaccessibleapp.so coalescetest CoalesceTest
+run libaccessibleapp.so eventstatstest EventStatsTest
+run libaccessibleapp.so eventlogtest EventLogTest
+run libaccessibleapp.so eventqueuetest EventQueueTest
+run libaccessibleapp.so keystroketest KeystrokeTest
+run libaccessibleapp.so pumptest PumpTest
+run libaccessibleapp.so polltest PollTest
+run libaccessibleapp.so pipelinetest PipelineTest
+run libaccessibleapp.so eventfiltertest EventFilterTest
+run libaccessibleapp.so traversaltest TraversalTest
+run libaccessibleapp.so matchtest MatchTest
+run libaccessibleapp.so paralleltest ParallelSearchTest
+run libaccessibleapp.so childrentest ChildrenTest
+run libaccessibleapp.so snapshottest SnapshotTest
+run libaccessibleapp.so mirrortest MirrorTest
+run libaccessibleapp.so cacheleveltest CacheLevelTest
+run libaccessibleapp.so cachebudgettest CacheBudgetTest
+run libaccessibleapp.so parentcachetest ParentCacheTest
 exit $ret
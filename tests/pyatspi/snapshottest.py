@@ -0,0 +1,137 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+from pasytest import PasyTest as _PasyTest
+
+import pyatspi
+from pyatspi import snapshotTree
+
+from fixtures import fakeTree
+
+class _StateSet(object):
+	def __init__(self, states):
+		self.states = states
+
+class _Component(object):
+	def __init__(self, node):
+		self.node = node
+
+	def getExtents(self, coord_type):
+		return (len(self.node.name), 0, 10, 20)
+
+def _decorate(node):
+	"""
+	Gives the nodes of a fake tree what a snapshot reads.
+	"""
+	node.role = pyatspi.ROLE_PANEL if node.children else pyatspi.ROLE_LABEL
+	node.getRole = lambda: node.role
+	node.getState = lambda: _StateSet(1 << int(pyatspi.STATE_SHOWING))
+	node.queryComponent = lambda: _Component(node)
+	node.description = "leaf" if not node.children else ""
+	for child in node.children:
+		_decorate(child)
+	return node
+
+class SnapshotTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_structure",
+		     "test_fields",
+		     "test_failing",
+		     "test_limits",
+		     "test_unknown_field",
+		     "test_objects",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "Snapshot", False)
+
+	def setup(self, test):
+		pass
+
+	def test_structure(self, test):
+		snapshot = snapshotTree(_decorate(fakeTree()))
+		# breadth first: root, a, b, a1, a2, b1, a11
+		test.assertEqual(len(snapshot), 7, "Wrong node count")
+		test.assertEqual(list(snapshot.parent), [-1, 0, 0, 1, 1, 2, 3], "Wrong parents")
+		test.assertEqual(list(snapshot.depth), [0, 1, 1, 2, 2, 2, 3], "Wrong depths")
+		test.assertEqual(list(snapshot.children(0)), [1, 2], "Wrong children of the root")
+		test.assertEqual(list(snapshot.children(1)), [3, 4], "Wrong children of a")
+		test.assertEqual(list(snapshot.children(6)), [], "Children of a leaf")
+		test.assertEqual(snapshot.getParent(6), 3, "Wrong parent of a11")
+
+	def test_fields(self, test):
+		snapshot = snapshotTree(_decorate(fakeTree()),
+					fields=("role", "states", "name", "description", "extents"))
+		test.assertEqual([snapshot.getName(i) for i in range(len(snapshot))],
+				 ["root", "a", "b", "a1", "a2", "b1", "a11"], "Wrong names")
+		test.assertEqual(snapshot.role[6], int(pyatspi.ROLE_LABEL), "Wrong role")
+		test.assertEqual(snapshot.hasState(0, pyatspi.STATE_SHOWING), True,
+				 "State not copied")
+		test.assertEqual(snapshot.hasState(0, pyatspi.STATE_FOCUSED), False,
+				 "Missing state copied")
+		test.assertEqual(snapshot.getExtents(6), (3, 0, 10, 20), "Wrong extents")
+		# the four leaves share one interned description
+		test.assertEqual(snapshot.strings.count("leaf"), 1, "Strings not interned")
+		test.assertEqual(snapshot.getDescription(5), "leaf", "Wrong description")
+		test.assertEqual(snapshot.description[0], 0, "Empty string not interned as 0")
+
+	def test_failing(self, test):
+		root = _decorate(fakeTree())
+		b = root.find("b")
+
+		def gone(*args):
+			raise RuntimeError("The application no longer exists")
+		b.getRole = b.getState = b.queryComponent = gone
+		snapshot = snapshotTree(root, fields=("role", "states", "extents"))
+		test.assertEqual((snapshot.role[2], snapshot.states[2]), (0, 0),
+				 "Failing node not given empty values")
+		test.assertEqual(snapshot.getExtents(2), (0, 0, -1, -1),
+				 "Failing node given extents")
+		test.assertEqual(len(snapshot), 7, "Walk stopped at a failing node")
+
+	def test_limits(self, test):
+		test.assertEqual(len(snapshotTree(_decorate(fakeTree()), max_depth=1)), 3,
+				 "Nodes below max_depth copied")
+		snapshot = snapshotTree(_decorate(fakeTree()), max_nodes=4)
+		test.assertEqual(len(snapshot), 4, "More than max_nodes copied")
+		test.assertEqual(list(snapshot.children(1)), [3], "Wrong truncated children")
+
+	def test_unknown_field(self, test):
+		try:
+			snapshotTree(_decorate(fakeTree()), fields=("name", "colour"))
+		except ValueError:
+			pass
+		else:
+			test.fail("Unknown field accepted")
+
+	def test_objects(self, test):
+		root = _decorate(fakeTree())
+		snapshot = snapshotTree(root)
+		if snapshot.accessible(6) is not root.find("a11"):
+			test.fail("Wrong accessible kept")
+		snapshot = snapshotTree(root, keep_objects=False)
+		try:
+			snapshot.accessible(6)
+		except ValueError:
+			pass
+		else:
+			test.fail("Accessible given without keep_objects")
+
+	def teardown(self, test):
+		pass
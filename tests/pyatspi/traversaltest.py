@@ -0,0 +1,136 @@
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Library General Public
+# License as published by the Free Software Foundation; either
+# version 2 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Library General Public License for more details.
+#
+# You should have received a copy of the GNU Library General Public
+# License along with this library; if not, write to the
+# Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+# Boston, MA 02110-1301, USA.
+#
+
+from pasytest import PasyTest as _PasyTest
+
+from pyatspi.utils import *
+
+from fixtures import fakeTree, names
+
+class TraversalTest(_PasyTest):
+
+	__tests__ = ["setup",
+		     "test_depth_first",
+		     "test_breadth_first",
+		     "test_max_depth",
+		     "test_max_nodes",
+		     "test_prune",
+		     "test_cycle",
+		     "test_find_descendant",
+		     "test_find_all_descendants",
+		     "test_find_ancestor",
+		     "test_get_path",
+		     "teardown",
+		     ]
+
+	def __init__(self, bus, path):
+		_PasyTest.__init__(self, "Traversal", False)
+
+	def setup(self, test):
+		pass
+
+	def test_depth_first(self, test):
+		test.assertEqual(names(iterDescendants(fakeTree())),
+				 ["a", "a1", "a11", "a2", "b", "b1"],
+				 "Wrong depth first order")
+
+	def test_breadth_first(self, test):
+		test.assertEqual(names(iterDescendants(fakeTree(), True)),
+				 ["a", "b", "a1", "a2", "b1", "a11"],
+				 "Wrong breadth first order")
+
+	def test_max_depth(self, test):
+		test.assertEqual(names(iterDescendants(fakeTree(), max_depth=1)),
+				 ["a", "b"], "Nodes below max_depth visited")
+		test.assertEqual(names(iterDescendants(fakeTree(), True, max_depth=2)),
+				 ["a", "b", "a1", "a2", "b1"], "Nodes below max_depth visited")
+
+	def test_max_nodes(self, test):
+		test.assertEqual(names(iterDescendants(fakeTree(), max_nodes=3)),
+				 ["a", "a1", "a11"], "More than max_nodes visited")
+		test.assertEqual(names(iterDescendants(fakeTree(), True, max_nodes=3)),
+				 ["a", "b", "a1"], "More than max_nodes visited")
+
+	def test_prune(self, test):
+		prune = lambda node: node.name == "a"
+		test.assertEqual(names(iterDescendants(fakeTree(), prune=prune)),
+				 ["a", "b", "b1"], "Pruned subtree visited")
+
+		def broken(node):
+			raise RuntimeError
+		test.assertEqual(names(iterDescendants(fakeTree(), prune=broken)),
+				 ["a", "a1", "a11", "a2", "b", "b1"],
+				 "Failing prune predicate stopped the traversal")
+
+	def test_cycle(self, test):
+		root = fakeTree()
+		a11 = root.find("a11")
+		# a node which is its own descendant
+		a11.children.append(root.children[0])
+		test.assertEqual(names(iterDescendants(root)),
+				 ["a", "a1", "a11", "a2", "b", "b1"],
+				 "Cycle not walked once")
+
+	def test_find_descendant(self, test):
+		root = fakeTree()
+		leaf = lambda node: not node.children
+		test.assertEqual(findDescendant(root, leaf).name, "a11",
+				 "Wrong depth first match")
+		test.assertEqual(findDescendant(root, leaf, True).name, "a2",
+				 "Wrong breadth first match")
+		test.assertEqual(findDescendant(root, leaf, max_depth=1), None,
+				 "Match found below max_depth")
+		test.assertEqual(findDescendant(root, leaf, max_nodes=2), None,
+				 "Match found past max_nodes")
+		test.assertEqual(findDescendant(root, lambda node: node.name == "a2",
+						prune=lambda node: node.name == "a"), None,
+				 "Match found in a pruned subtree")
+
+	def test_find_all_descendants(self, test):
+		root = fakeTree()
+		leaf = lambda node: not node.children
+		test.assertEqual(names(findAllDescendants(root, leaf)),
+				 ["a11", "a2", "b1"], "Wrong matches")
+		test.assertEqual(names(findAllDescendants(root, leaf, max_depth=2)),
+				 ["a2", "b1"], "Match found below max_depth")
+		test.assertEqual(names(findAllDescendants(root, leaf, max_nodes=4)),
+				 ["a11", "a2"], "Match found past max_nodes")
+		test.assertEqual(names(findAllDescendants(root, leaf,
+							   prune=lambda node: node.name == "b")),
+				 ["a11", "a2"], "Match found in a pruned subtree")
+
+	def test_find_ancestor(self, test):
+		root = fakeTree()
+		a11 = root.find("a11")
+		test.assertEqual(findAncestor(a11, lambda node: node.name == "a").name, "a",
+				 "Ancestor not found")
+		test.assertEqual(findAncestor(a11, lambda node: node.name == "root", 2), None,
+				 "Ancestor found above max_depth")
+		test.assertEqual(findAncestor(a11, lambda node: False), None,
+				 "Match found above the top")
+		# a node which is its own ancestor
+		root.parent = a11
+		test.assertEqual(findAncestor(a11, lambda node: False), None,
+				 "Cycle not detected")
+
+	def test_get_path(self, test):
+		root = fakeTree()
+		test.assertEqual(getPath(root.find("a2")), [0, 1], "Wrong path")
+		test.assertEqual(getPath(root.find("b1")), [1, 0], "Wrong path")
+
+	def teardown(self, test):
+		pass